@@ -0,0 +1,158 @@
+// Measures lines/sec of reader feeding consumer threads depending on
+// placement: unpinned, reader and consumers on one NUMA node, consumers on
+// other node than reader with blocks on the reader node, the same with
+// blocks placed on the node of consumers. Input goes through a pipe, so
+// chunks blocks refer to are filled by the reader thread; regular files
+// would be mapped from page cache that stays wherever the kernel put it.
+// Consumers read every byte of blocks, so remote blocks cost cross-socket
+// memory traffic. Remote placements are skipped on machines with one node.
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <affinity.h>
+#include <block.h>
+#include <mpmc_queue.h>
+#include <reader.h>
+#include <reader_subscriber.h>
+
+using namespace std;
+using namespace griha;
+
+namespace {
+
+struct Forwarder : ReaderSubscriber {
+    MpmcQueue<BlockPtr> queue;
+    void on_block(const BlockPtr& stms) override { queue.push(stms); }
+    void on_unexpected_eof(const BlockPtr&) override {}
+};
+
+string make_input(const string& dir, size_t nlines) {
+    auto path = dir + "/bulkmt_affinity_XXXXXX";
+    auto fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        perror("mkstemp");
+        exit(1);
+    }
+    close(fd);
+
+    ofstream output { path };
+    for (size_t i = 0; i < nlines; ++i)
+        output << "command with some payload " << i << '\n';
+    return path;
+}
+
+bool write_all(int fd, const char* data, size_t size) {
+    while (size != 0) {
+        auto n = write(fd, data, size);
+        if (n < 0)
+            return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// empty CPU sets - threads aren't pinned, negative node - memory isn't placed
+void measure(const char* name, const string& path, size_t nlines, size_t block_size,
+             size_t nconsumers, const CpuSet& reader_cpus, const CpuSet& consumer_cpus,
+             int memory_node = -1) {
+    Reader reader { block_size };
+    auto forwarder = make_shared<Forwarder>();
+    reader.subscribe(forwarder);
+
+    const auto start = chrono::steady_clock::now();
+
+    vector<thread> consumers;
+    vector<size_t> checksums(nconsumers, 0);
+    for (size_t i = 0; i < nconsumers; ++i) {
+        consumers.emplace_back([&forwarder, &checksums, i] {
+            BlockPtr stms;
+            size_t sum = 0;
+            while (forwarder->queue.pop(stms))
+                for (auto c : stms->bytes())
+                    sum += static_cast<unsigned char>(c);
+            checksums[i] = sum;
+        });
+        if (!consumer_cpus.empty())
+            pin_thread(consumers.back().native_handle(), consumer_cpus);
+    }
+
+    // reader runs in its own thread, so pinning doesn't stick to main one
+    thread producer { [&] {
+        if (!reader_cpus.empty())
+            pin_current_thread(reader_cpus);
+        if (memory_node >= 0)
+            prefer_node_memory(memory_node);
+        int fds[2];
+        if (pipe(fds) != 0) {
+            perror("pipe");
+            exit(1);
+        }
+        // feeder inherits CPUs of the reader
+        thread feeder { [&path, fd = fds[1]] {
+            auto input = open(path.c_str(), O_RDONLY);
+            char buffer[64 << 10];
+            ssize_t n;
+            while ((n = read(input, buffer, sizeof(buffer))) > 0 && write_all(fd, buffer, static_cast<size_t>(n)));
+            close(input);
+            close(fd);
+        } };
+        reader.run(fds[0]);
+        close(fds[0]);
+        feeder.join();
+        forwarder->queue.close();
+    } };
+    producer.join();
+    for (auto& t : consumers)
+        t.join();
+
+    const auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    size_t checksum = 0;
+    for (auto sum : checksums)
+        checksum += sum;
+    cout << setw(10) << name
+         << setw(20) << fixed << setprecision(0) << nlines / elapsed
+         << setw(20) << checksum << endl;
+}
+
+} // unnamed namespace
+
+int main(int argc, char* argv[]) {
+    const size_t nlines = argc > 1 ? stoul(argv[1]) : 20000000u;
+    const string dir = argc > 2 ? argv[2] : ".";
+    const size_t block_size = argc > 3 ? stoul(argv[3]) : 1000u;
+    const size_t nconsumers = argc > 4 ? stoul(argv[4]) : max(thread::hardware_concurrency() / 2, 1u);
+
+    const auto path = make_input(dir, nlines);
+    const auto nnodes = numa_nodes();
+
+    cout << "lines - " << nlines << "; block size - " << block_size
+         << "; consumers - " << nconsumers << "; NUMA nodes - " << nnodes << endl;
+    cout << setw(10) << "placement" << setw(20) << "lines/s" << setw(20) << "checksum" << endl;
+
+    measure("any", path, nlines, block_size, nconsumers, {}, {});
+
+    const auto local = numa_node_cpus(0);
+    measure("local", path, nlines, block_size, nconsumers, local, local);
+
+    if (nnodes > 1) {
+        measure("remote", path, nlines, block_size, nconsumers, local, numa_node_cpus(1));
+        measure("placed", path, nlines, block_size, nconsumers, local, numa_node_cpus(1), 1);
+    } else {
+        cout << setw(10) << "remote" << "     skipped, one NUMA node" << endl;
+    }
+
+    remove(path.c_str());
+    return 0;
+}
\ No newline at end of file
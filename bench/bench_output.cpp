@@ -0,0 +1,100 @@
+// Compares writing of bulk files: ofstream per block (file_job) against
+// asynchronous output engines - io_uring and thread pool with pwritev.
+// Every writing thread owns its engine like file threads of the interpreter.
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <block.h>
+#include <output_engine.h>
+
+using namespace std;
+using namespace griha;
+
+namespace {
+
+BlockPtr make_block(size_t nstatements) {
+    BlockBuilder builder;
+    for (auto i = 0u; i < nstatements; ++i)
+        builder.append("cmd" + to_string(i), nullptr);
+    return builder.build();
+}
+
+string filename(const string& dir, size_t thread, size_t i) {
+    return dir + "/bench_" + to_string(thread) + "_" + to_string(i) + ".log";
+}
+
+// the way file_job writes blocks
+void write_stream(const string& dir, size_t thread, size_t nblocks, const BlockPtr& block) {
+    for (auto i = 0u; i < nblocks; ++i) {
+        ofstream output { filename(dir, thread, i) };
+        const auto bytes = block->bytes();
+        output.write(bytes.data(), static_cast<streamsize>(bytes.size()));
+        output.flush();
+        output.close();
+    }
+}
+
+void write_engine(OutputBackend backend, const string& dir, size_t thread, size_t nblocks, const BlockPtr& block) {
+    auto engine = make_output_engine(backend);
+    for (auto i = 0u; i < nblocks; ++i)
+        engine->write(filename(dir, thread, i), block);
+    engine->drain();
+}
+
+using Writer = function<void (const string&, size_t, size_t, const BlockPtr&)>;
+
+double run(const Writer& writer, const string& dir, size_t nthreads, size_t nblocks, const BlockPtr& block) {
+    const auto per_thread = nblocks / nthreads;
+
+    const auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (auto i = 0u; i < nthreads; ++i)
+        threads.emplace_back(writer, dir, i, per_thread, block);
+    for (auto& t : threads)
+        t.join();
+    const auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    for (auto t = 0u; t < nthreads; ++t)
+        for (auto i = 0u; i < per_thread; ++i)
+            remove(filename(dir, t, i).c_str());
+
+    return per_thread * nthreads / elapsed;
+}
+
+} // unnamed namespace
+
+int main(int argc, char* argv[]) {
+    const size_t nblocks = argc > 1 ? stoul(argv[1]) : 20000u;
+    const string dir = argc > 2 ? argv[2] : ".";
+    const size_t block_size = argc > 3 ? stoul(argv[3]) : 3u;
+
+    const auto block = make_block(block_size);
+    const auto uring = bind(write_engine, OutputBackend::uring, placeholders::_1, placeholders::_2,
+                            placeholders::_3, placeholders::_4);
+    const auto pool = bind(write_engine, OutputBackend::pool, placeholders::_1, placeholders::_2,
+                           placeholders::_3, placeholders::_4);
+
+    cout << "blocks - " << nblocks << "; statements per block - " << block_size
+         << "; engine - " << backend_name(available_backend(OutputBackend::uring)) << endl;
+    cout << setw(10) << "threads" << setw(20) << "stream, bulk/s" << setw(20) << "uring, bulk/s"
+         << setw(20) << "pool, bulk/s" << endl;
+    for (size_t nthreads = 1; nthreads <= 8; nthreads *= 2) {
+        const auto stream_rate = run(write_stream, dir, nthreads, nblocks, block);
+        const auto uring_rate = run(uring, dir, nthreads, nblocks, block);
+        const auto pool_rate = run(pool, dir, nthreads, nblocks, block);
+        cout << fixed << setprecision(0)
+             << setw(10) << nthreads
+             << setw(20) << stream_rate
+             << setw(20) << uring_rate
+             << setw(20) << pool_rate << endl;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+// Compares queue behind Worker: list guarded by mutex (previous implementation)
+// against lock-free bounded MPMC ring buffer.
+// One producer (like the reader) feeds 1..32 consumer threads.
+
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mpmc_queue.h>
+
+using namespace std;
+using namespace griha;
+
+namespace {
+
+using Item = shared_ptr<const size_t>;
+
+// the queue Worker used before: consumers take away the whole list at once
+class ListQueue {
+public:
+    void push(Item item) {
+        {
+            lock_guard<mutex> l { guard_ };
+            items_.push_back(move(item));
+        }
+        cv_.notify_one();
+    }
+
+    template <typename Handler>
+    void consume(Handler&& handler) {
+        auto exit = false;
+        while (!exit) {
+            unique_lock<mutex> l { guard_ };
+            cv_.wait(l, [this] { return stopped_ || !items_.empty(); });
+            exit = stopped_;
+            list<Item> local;
+            swap(items_, local);
+            l.unlock();
+
+            for (auto& item : local)
+                handler(item);
+        }
+    }
+
+    void close() {
+        {
+            lock_guard<mutex> l { guard_ };
+            stopped_ = true;
+        }
+        cv_.notify_all();
+    }
+
+private:
+    mutex guard_;
+    condition_variable cv_;
+    list<Item> items_;
+    bool stopped_ { false };
+};
+
+class RingQueue {
+public:
+    void push(Item item) { queue_.push(move(item)); }
+
+    template <typename Handler>
+    void consume(Handler&& handler) {
+        Item item;
+        while (queue_.pop(item)) {
+            handler(item);
+            item.reset();
+        }
+    }
+
+    void close() { queue_.close(); }
+
+private:
+    MpmcQueue<Item> queue_;
+};
+
+template <typename Queue>
+double run(size_t nconsumers, size_t nitems) {
+    Queue queue;
+    vector<size_t> sums(nconsumers * 8); // padded to avoid false sharing
+
+    vector<thread> consumers;
+    for (auto i = 0u; i < nconsumers; ++i)
+        consumers.emplace_back([&queue, &sums, i] {
+            queue.consume([&sums, i] (const Item& item) { sums[i * 8] += *item; });
+        });
+
+    const auto start = chrono::steady_clock::now();
+    auto item = make_shared<const size_t>(1u);
+    for (auto i = 0u; i < nitems; ++i)
+        queue.push(item);
+    queue.close();
+    for (auto& t : consumers)
+        t.join();
+    const auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    return nitems / elapsed;
+}
+
+} // unnamed namespace
+
+int main(int argc, char* argv[]) {
+    const size_t nitems = argc > 1 ? stoul(argv[1]) : 1000000u;
+
+    cout << "items - " << nitems << endl;
+    cout << setw(10) << "threads" << setw(20) << "list+mutex, op/s" << setw(20) << "mpmc ring, op/s" << endl;
+    for (size_t nthreads = 1; nthreads <= 32; nthreads *= 2) {
+        const auto list_rate = run<ListQueue>(nthreads, nitems);
+        const auto ring_rate = run<RingQueue>(nthreads, nitems);
+        cout << fixed << setprecision(0)
+             << setw(10) << nthreads
+             << setw(20) << list_rate
+             << setw(20) << ring_rate << endl;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+// Measures lines/sec of Reader on generated input: fixed size blocks with
+// explicit (partially nested) blocks between them. Subscriber only counts
+// blocks, so the time is spent in the reader and its state machine.
+// Descriptor, stream and parallel parsing of descriptor are measured.
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <reader.h>
+#include <reader_subscriber.h>
+
+using namespace std;
+using namespace griha;
+
+namespace {
+
+struct Counter : ReaderSubscriber {
+    size_t nblocks { 0 };
+    void on_block(const BlockPtr&) override { ++nblocks; }
+    void on_unexpected_eof(const BlockPtr&) override {}
+};
+
+string make_input(const string& dir, size_t nlines) {
+    auto path = dir + "/bulkmt_reader_XXXXXX";
+    auto fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        perror("mkstemp");
+        exit(1);
+    }
+    close(fd);
+
+    ofstream output { path };
+    for (size_t i = 0; i < nlines; ++i) {
+        switch (i % 32) {
+        case 10: case 12: output << "{\n"; break;
+        case 14: case 20: output << "}\n"; break;
+        default: output << "cmd" << i << '\n'; break;
+        }
+    }
+    return path;
+}
+
+template <typename Run>
+void measure(const char* name, size_t nlines, Run&& run) {
+    const auto start = chrono::steady_clock::now();
+    const auto nblocks = run();
+    const auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << setw(10) << name
+         << setw(20) << fixed << setprecision(0) << nlines / elapsed
+         << setw(15) << nblocks << endl;
+}
+
+} // unnamed namespace
+
+int main(int argc, char* argv[]) {
+    const size_t nlines = argc > 1 ? stoul(argv[1]) : 50000000u;
+    const string dir = argc > 2 ? argv[2] : ".";
+    const size_t block_size = argc > 3 ? stoul(argv[3]) : 3u;
+    const size_t nthreads = argc > 4 ? stoul(argv[4]) : max(thread::hardware_concurrency(), 2u);
+
+    const auto path = make_input(dir, nlines);
+
+    cout << "lines - " << nlines << "; block size - " << block_size
+         << "; parse threads - " << nthreads << endl;
+    cout << setw(10) << "input" << setw(20) << "lines/s" << setw(15) << "blocks" << endl;
+
+    measure("fd", nlines, [&] {
+        Reader reader { block_size };
+        auto counter = make_shared<Counter>();
+        reader.subscribe(counter);
+        auto fd = open(path.c_str(), O_RDONLY);
+        reader.run(fd);
+        close(fd);
+        return counter->nblocks;
+    });
+
+    measure("stream", nlines, [&] {
+        Reader reader { block_size };
+        auto counter = make_shared<Counter>();
+        reader.subscribe(counter);
+        ifstream input { path };
+        reader.run(input);
+        return counter->nblocks;
+    });
+
+    measure("parallel", nlines, [&] {
+        Reader reader { block_size };
+        auto counter = make_shared<Counter>();
+        reader.subscribe(counter);
+        auto fd = open(path.c_str(), O_RDONLY);
+        reader.run(fd, nthreads);
+        close(fd);
+        return counter->nblocks;
+    });
+
+    remove(path.c_str());
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+// Compares splitting of input into classified lines: the previous path of
+// Reader (std::getline from stream and comparison of every line with "{"
+// and "}") against the window scanner with scalar (memchr), SSE2 and AVX2
+// search of new lines. Input is generated into a temporary file and read
+// through ChunkReader like Reader::run(fd) does.
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chunk_reader.h>
+#include <line_scanner.h>
+
+using namespace std;
+using namespace griha;
+
+namespace {
+
+// statements with explicit blocks between them
+int make_input(const string& dir, size_t size) {
+    auto path = dir + "/bulkmt_scanner_XXXXXX";
+    auto fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        perror("mkstemp");
+        exit(1);
+    }
+    unlink(path.c_str());
+
+    string buffer;
+    size_t written = 0;
+    for (size_t i = 0; written < size; ++i) {
+        if (i % 16 == 0)
+            buffer += "{\n";
+        buffer += "command " + to_string(i) + '\n';
+        if (i % 16 == 7)
+            buffer += "}\n";
+        if (buffer.size() >= (1u << 20)) {
+            if (write(fd, buffer.data(), buffer.size()) != static_cast<ssize_t>(buffer.size())) {
+                perror("write");
+                exit(1);
+            }
+            written += buffer.size();
+            buffer.clear();
+        }
+    }
+    return fd;
+}
+
+struct Counts {
+    size_t nstatements;
+    size_t nbegins;
+    size_t nends;
+};
+
+// the path of InitialState::process / BlockState::process before scanner
+Counts run_getline(int fd) {
+    Counts counts {};
+    // descriptor of removed file is opened again from the beginning
+    ifstream input { "/proc/self/fd/" + to_string(fd) };
+    string line;
+    while (getline(input, line)) {
+        if (line == "}"sv)
+            ++counts.nends;
+        else if (line == "{"sv)
+            ++counts.nbegins;
+        else
+            ++counts.nstatements;
+    }
+    return counts;
+}
+
+Counts run_scanner(int fd, ScanIsa isa) {
+    Counts counts {};
+    lseek(fd, 0, SEEK_SET);
+    ChunkReader reader { fd, c_default_chunk_size, isa };
+    string_view line;
+    LineKind kind;
+    while (reader.next_line(line, kind)) {
+        switch (kind) {
+        case LineKind::statement:   ++counts.nstatements; break;
+        case LineKind::block_begin: ++counts.nbegins; break;
+        case LineKind::block_end:   ++counts.nends; break;
+        }
+    }
+    return counts;
+}
+
+template <typename Run>
+void measure(const char* name, size_t size, Run&& run) {
+    const auto start = chrono::steady_clock::now();
+    const auto counts = run();
+    const auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << setw(10) << name
+         << setw(15) << fixed << setprecision(2) << size / elapsed / (1u << 30)
+         << setw(15) << counts.nstatements
+         << setw(10) << counts.nbegins
+         << setw(10) << counts.nends << endl;
+}
+
+} // unnamed namespace
+
+int main(int argc, char* argv[]) {
+    const size_t size = (argc > 1 ? stoul(argv[1]) : 2048u) << 20;
+    const string dir = argc > 2 ? argv[2] : ".";
+
+    auto fd = make_input(dir, size);
+    const auto actual_size = static_cast<size_t>(lseek(fd, 0, SEEK_END));
+
+    cout << "input - " << actual_size / (1u << 20) << " MiB; best isa - "
+         << (best_scan_isa() == ScanIsa::avx2 ? "avx2" : best_scan_isa() == ScanIsa::sse2 ? "sse2" : "scalar") << endl;
+    cout << setw(10) << "path" << setw(15) << "GiB/s" << setw(15) << "statements"
+         << setw(10) << "begins" << setw(10) << "ends" << endl;
+
+    measure("getline", actual_size, [fd] { return run_getline(fd); });
+    measure("scalar", actual_size, [fd] { return run_scanner(fd, ScanIsa::scalar); });
+    if (is_supported(ScanIsa::sse2))
+        measure("sse2", actual_size, [fd] { return run_scanner(fd, ScanIsa::sse2); });
+    if (is_supported(ScanIsa::avx2))
+        measure("avx2", actual_size, [fd] { return run_scanner(fd, ScanIsa::avx2); });
+
+    close(fd);
+    return 0;
+}
\ No newline at end of file
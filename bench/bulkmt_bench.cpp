@@ -0,0 +1,270 @@
+// Microbenchmarks of statement factory, reader, dispatch of blocks among
+// sink threads and sinks. Results are diffed between releases as JSON:
+//
+//   bulkmt_bench --benchmark_out=bulkmt_bench.json --benchmark_out_format=json
+//   compare.py benchmarks old.json new.json   (tools of Google Benchmark)
+
+#include <cstdio>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include <block.h>
+#include <block_queue.h>
+#include <console_sink.h>
+#include <executor.h>
+#include <output_engine.h>
+#include <reader.h>
+#include <reader_subscriber.h>
+#include <statement.h>
+#include <statement_factory.h>
+#include <work_stealing_queue.h>
+#include <worker.h>
+
+using namespace std;
+using namespace griha;
+
+namespace {
+
+constexpr size_t c_nlines = 100000;
+
+// shape of synthetic input
+enum Input {
+    flat,           // dynamic blocks only
+    nested,         // explicit blocks nested 16 levels deep
+    huge_explicit,  // explicit blocks of 10000 statements
+    long_lines      // dynamic blocks of 1 KiB lines
+};
+
+const char* input_name(int64_t input) {
+    static const char* names[] = { "flat", "nested", "huge_explicit", "long_lines" };
+    return names[input];
+}
+
+string make_input(int64_t input) {
+    string result;
+    const string payload = input == long_lines ? string(1024, 'x') : "cmd";
+    for (size_t i = 0; i < c_nlines; ++i) {
+        switch (input) {
+        case nested:
+            if (i % 64 < 16) { result += "{\n"; continue; }
+            if (i % 64 >= 48) { result += "}\n"; continue; }
+            break;
+        case huge_explicit:
+            if (i % 10002 == 0) { result += "{\n"; continue; }
+            if (i % 10002 == 10001) { result += "}\n"; continue; }
+            break;
+        default:
+            break;
+        }
+        result += payload + to_string(i) + '\n';
+    }
+    return result;
+}
+
+struct Counter : ReaderSubscriber {
+    size_t nblocks { 0 };
+    void on_block(const BlockPtr&) override { ++nblocks; }
+    void on_unexpected_eof(const BlockPtr&) override {}
+};
+
+BlockPtr make_block(size_t nstatements, size_t length) {
+    BlockBuilder builder;
+    const string value(length, 'x');
+    for (size_t i = 0; i < nstatements; ++i)
+        builder.append(value, nullptr);
+    return builder.build();
+}
+
+void StatementFactory_create(benchmark::State& state) {
+    const StatementFactory factory;
+    const string value(static_cast<size_t>(state.range(0)), 'x');
+    for (auto _ : state)
+        benchmark::DoNotOptimize(factory.create(value));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(StatementFactory_create)->ArgName("length")->Arg(8)->Arg(64)->Arg(1024);
+
+// flat block takes one allocation, builder buffers are reused between blocks
+void BlockBuilder_build(benchmark::State& state) {
+    BlockBuilder builder;
+    const string value(static_cast<size_t>(state.range(0)), 'x');
+    for (auto _ : state) {
+        for (auto i = 0; i < 64; ++i)
+            builder.append(value, nullptr);
+        benchmark::DoNotOptimize(builder.build());
+    }
+    state.SetItemsProcessed(state.iterations() * 64);
+    state.counters["allocations"] = benchmark::Counter(
+        static_cast<double>(builder.nallocations()), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BlockBuilder_build)->ArgName("length")->Arg(8)->Arg(64)->Arg(1024);
+
+void Reader_run_stream(benchmark::State& state) {
+    const auto input = make_input(state.range(0));
+    state.SetLabel(input_name(state.range(0)));
+    for (auto _ : state) {
+        Reader reader { 3 };
+        auto counter = make_shared<Counter>();
+        reader.subscribe(counter);
+        istringstream stream { input };
+        reader.run(stream);
+        benchmark::DoNotOptimize(counter->nblocks);
+    }
+    state.SetItemsProcessed(state.iterations() * c_nlines);
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(Reader_run_stream)->ArgName("input")->DenseRange(flat, long_lines)->Unit(benchmark::kMillisecond);
+
+void Reader_run_fd(benchmark::State& state) {
+    const auto input = make_input(state.range(0));
+    state.SetLabel(input_name(state.range(0)));
+    const auto fd = memfd_create("bulkmt_bench", 0);
+    if (fd < 0 || write(fd, input.data(), input.size()) != static_cast<ssize_t>(input.size())) {
+        state.SkipWithError("can't create input file");
+        return;
+    }
+    for (auto _ : state) {
+        lseek(fd, 0, SEEK_SET);
+        Reader reader { 3 };
+        auto counter = make_shared<Counter>();
+        reader.subscribe(counter);
+        reader.run(fd);
+        benchmark::DoNotOptimize(counter->nblocks);
+    }
+    close(fd);
+    state.SetItemsProcessed(state.iterations() * c_nlines);
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(Reader_run_fd)->ArgName("input")->DenseRange(flat, long_lines)->Unit(benchmark::kMillisecond);
+
+// blocks are dispatched among threads of file worker; job only sums bytes
+void Worker_dispatch(benchmark::State& state) {
+    const auto nthreads = static_cast<size_t>(state.range(0));
+    const auto stealing = state.range(1) != 0;
+    state.SetLabel(stealing ? "stealing" : "queue");
+
+    constexpr size_t c_nblocks = 10000;
+    vector<BlockPtr> blocks;
+    for (size_t i = 0; i < c_nblocks; ++i)
+        blocks.push_back(make_block(3, 16));
+
+    auto executor = make_shared<Executor>(nthreads);
+    for (auto _ : state) {
+        unique_ptr<BlockQueue> queue;
+        if (stealing && nthreads > 1)
+            queue = make_unique<WorkStealingQueue>(nthreads, c_default_queue_capacity);
+        else
+            queue = make_unique<RingBlockQueue>(c_default_queue_capacity);
+
+        auto job = [] (const Block& stms) {
+            size_t sum = 0;
+            for (auto c : stms.bytes())
+                sum += static_cast<unsigned char>(c);
+            benchmark::DoNotOptimize(sum);
+        };
+        Worker worker { executor, LaneOptions { nthreads, 1, 0 }, job, move(queue), Overflow::block, "." };
+        for (auto& block : blocks)
+            worker.send(block);
+        worker.stop();
+        worker.join();
+    }
+    state.SetItemsProcessed(state.iterations() * c_nblocks);
+}
+BENCHMARK(Worker_dispatch)
+    ->ArgNames({ "threads", "stealing" })
+    ->ArgsProduct({ { 1, 2, 4, 8 }, { 0, 1 } })
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+void ConsoleSink_write(benchmark::State& state) {
+    const auto fd = open("/dev/null", O_WRONLY);
+    ConsoleOptions options;
+    options.flush = state.range(0) == 0 ? ConsoleFlush::per_bulk : ConsoleFlush::by_size;
+    state.SetLabel(state.range(0) == 0 ? "per_bulk" : "by_size");
+
+    const auto block = make_block(3, 16);
+    {
+        ConsoleSink sink { options, fd };
+        for (auto _ : state)
+            sink(*block);
+    }
+    close(fd);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(ConsoleSink_write)->ArgName("by_size")->Arg(0)->Arg(1);
+
+// sums lengths of values: per statement through virtual visitor or per run
+void Block_execute(benchmark::State& state) {
+    struct Summer : Executer {
+        size_t total = 0;
+        using Executer::execute;
+        void execute(const SomeStatement& stm) override { total += stm.value().size(); }
+    };
+
+    const auto block = make_block(64, 16);
+    const auto batched = state.range(0) != 0;
+    state.SetLabel(batched ? "batch" : "statement");
+    Summer summer;
+    for (auto _ : state) {
+        if (batched)
+            visit_batches(*block, [&summer] (const auto& batch) {
+                for (auto value : batch)
+                    summer.total += value.size();
+            });
+        else
+            static_cast<Executer&>(summer).execute(*block);
+    }
+    benchmark::DoNotOptimize(summer.total);
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(block->size()));
+}
+BENCHMARK(Block_execute)->ArgName("batched")->Arg(0)->Arg(1);
+
+void remove_bulk_files(const string& dir) {
+    if (auto d = opendir(dir.c_str())) {
+        while (auto entry = readdir(d))
+            if (string { entry->d_name }.rfind("bulk_", 0) == 0)
+                remove((dir + '/' + entry->d_name).c_str());
+        closedir(d);
+    }
+}
+
+// files are written into temporary directory which is made current
+void file_job_write(benchmark::State& state) {
+    char dir[] = "/tmp/bulkmt_bench_XXXXXX";
+    char cwd[4096];
+    if (mkdtemp(dir) == nullptr || getcwd(cwd, sizeof(cwd)) == nullptr || chdir(dir) != 0) {
+        state.SkipWithError("can't create directory of bulk files");
+        return;
+    }
+
+    const auto block = make_block(3, static_cast<size_t>(state.range(0)));
+    size_t n = 0;
+    for (auto _ : state) {
+        file_job(*block);
+        if (++n % 10000 == 0) {
+            state.PauseTiming();
+            remove_bulk_files(".");
+            state.ResumeTiming();
+        }
+    }
+
+    remove_bulk_files(".");
+    if (chdir(cwd) != 0)
+        state.SkipWithError("can't restore current directory");
+    rmdir(dir);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(file_job_write)->ArgName("length")->Arg(16)->Arg(1024);
+
+} // unnamed namespace
+
+BENCHMARK_MAIN();
\ No newline at end of file
@@ -0,0 +1,166 @@
+// Runs bulkmt on the workload file at every combination of block size and
+// number of file threads and reports throughput, peak RSS and tail latency
+// from the first statement of block to its console and file output:
+//
+//   bulkmt_workload --commands 1000000 > workload.txt
+//   bulkmt_harness ./bulkmt workload.txt 1,10,100 1,2,4
+//
+// bulkmt runs in temporary directory, its bulk files are removed after
+// every run. Console output is discarded.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+struct Result {
+    double seconds;
+    size_t nlines { 0 };
+    size_t nblocks { 0 };
+    long peak_rss_kb { 0 };
+    // end to end latency of console and file output, us
+    size_t log_p99 { 0 }, log_p999 { 0 };
+    size_t file_p99 { 0 }, file_p999 { 0 };
+};
+
+vector<size_t> parse_list(const string& list) {
+    vector<size_t> result;
+    istringstream is { list };
+    for (string item; getline(is, item, ','); )
+        result.push_back(stoul(item));
+    return result;
+}
+
+// value following "<name> - " in line
+size_t field(const string& line, const string& name) {
+    const auto pos = line.find(name + " - ");
+    return pos == string::npos ? 0u : stoul(line.substr(pos + name.size() + 3));
+}
+
+void remove_dir(const string& dir) {
+    if (auto d = opendir(dir.c_str())) {
+        while (auto entry = readdir(d)) {
+            const string name = entry->d_name;
+            if (name != "." && name != "..")
+                remove((dir + '/' + name).c_str());
+        }
+        closedir(d);
+    }
+    rmdir(dir.c_str());
+}
+
+Result run(const string& binary, const string& workload, size_t block_size, size_t nthreads) {
+    char dir[] = "/tmp/bulkmt_harness_XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        perror("mkdtemp");
+        exit(1);
+    }
+    int metrics[2];
+    if (pipe(metrics) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+
+    const auto start = chrono::steady_clock::now();
+    const auto pid = fork();
+    if (pid == 0) {
+        const auto input = open(workload.c_str(), O_RDONLY);
+        const auto null = open("/dev/null", O_WRONLY);
+        if (input < 0 || null < 0 || chdir(dir) != 0) {
+            perror(workload.c_str());
+            _exit(127);
+        }
+        dup2(input, STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        dup2(metrics[1], STDERR_FILENO);
+        close(metrics[0]);
+
+        const auto bs = to_string(block_size);
+        const auto nt = to_string(nthreads);
+        execl(binary.c_str(), binary.c_str(), bs.c_str(), nt.c_str(), nullptr);
+        perror(binary.c_str());
+        _exit(127);
+    }
+    close(metrics[1]);
+
+    // metrics are printed at exit, so the pipe can't fill up before
+    string text;
+    char buffer[4096];
+    for (ssize_t n; (n = read(metrics[0], buffer, sizeof(buffer))) > 0; )
+        text.append(buffer, static_cast<size_t>(n));
+    close(metrics[0]);
+
+    int status;
+    rusage usage;
+    wait4(pid, &status, 0, &usage);
+    Result result;
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    remove_dir(dir);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        cerr << binary << " failed:" << endl << text;
+        exit(1);
+    }
+
+    result.peak_rss_kb = usage.ru_maxrss;
+    istringstream is { text };
+    string section;
+    for (string line; getline(is, line); ) {
+        if (line.find("\tLog:") == 0 || line.find("\tFiles:") == 0) {
+            section = line;
+        } else if (line.find("lines - ") != string::npos) {
+            result.nlines = field(line, "lines");
+            result.nblocks = field(line, "blocks");
+        } else if (line.find("end to end, us:") != string::npos) {
+            auto& p99 = section == "\tLog:" ? result.log_p99 : result.file_p99;
+            auto& p999 = section == "\tLog:" ? result.log_p999 : result.file_p999;
+            p99 = field(line, "p99");
+            p999 = field(line, "p99.9");
+        }
+    }
+    return result;
+}
+
+} // unnamed namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: bulkmt_harness <bulkmt> <workload> [block sizes] [file threads]" << endl;
+        return 1;
+    }
+
+    const string binary = argv[1];
+    const string workload = argv[2];
+    const auto block_sizes = parse_list(argc > 3 ? argv[3] : "1,10,100");
+    const auto nthreads = parse_list(argc > 4 ? argv[4] : "1,2,4");
+
+    cout << setw(8) << "block" << setw(8) << "threads"
+         << setw(14) << "lines/s" << setw(14) << "bulks/s" << setw(12) << "RSS, KiB"
+         << setw(14) << "log p99, us" << setw(16) << "log p99.9, us"
+         << setw(15) << "file p99, us" << setw(17) << "file p99.9, us" << endl;
+
+    for (auto block_size : block_sizes)
+        for (auto n : nthreads) {
+            const auto r = run(binary, workload, block_size, n);
+            cout << setw(8) << block_size << setw(8) << n
+                 << setw(14) << fixed << setprecision(0) << r.nlines / r.seconds
+                 << setw(14) << r.nblocks / r.seconds
+                 << setw(12) << r.peak_rss_kb
+                 << setw(14) << r.log_p99 << setw(16) << r.log_p999
+                 << setw(15) << r.file_p99 << setw(17) << r.file_p999 << endl;
+        }
+    return 0;
+}
\ No newline at end of file
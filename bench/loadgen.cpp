@@ -0,0 +1,209 @@
+// Load generator of server mode. nclients connections are driven by
+// nthreads threads; every client sends ncommands commands
+// "c<client>.<number>.<send time, ns>" at given rate, every n-th command
+// is wrapped into explicit block. If standard input isn't a terminal,
+// it's read as console output of the server and latency from sending of
+// command to its appearance in bulk output is measured:
+//
+//   bulkmt 10 --listen unix:/tmp/bulkmt.sock --max-block-age 50 | bulkmt_loadgen unix:/tmp/bulkmt.sock
+//
+// Commands still waiting in the server are reported as missing after
+// drain timeout.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <histogram.h>
+#include <socket_address.h>
+
+using namespace std;
+using namespace griha;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+constexpr auto c_drain_timeout = 5s;
+
+struct Load {
+    size_t nclients;
+    size_t ncommands;
+    double rate;            // commands per second of client, 0 - unlimited
+    size_t explicit_every;  // 0 - never
+};
+
+uint64_t now_ns() {
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+        Clock::now().time_since_epoch()).count());
+}
+
+void write_all(int fd, const string& data) {
+    for (size_t n = 0; n < data.size(); ) {
+        const auto written = send(fd, data.data() + n, data.size() - n, MSG_NOSIGNAL);
+        if (written < 0) {
+            perror("send");
+            exit(1);
+        }
+        n += static_cast<size_t>(written);
+    }
+}
+
+// sends commands of clients [first, last) round by round
+void send_commands(const SocketAddress& address, const Load& load, size_t first, size_t last) {
+    vector<int> fds;
+    for (auto client = first; client < last; ++client)
+        fds.push_back(connect_socket(address));
+
+    string data;
+    const auto start = Clock::now();
+    for (size_t number = 1; number <= load.ncommands; ++number) {
+        if (load.rate > 0)
+            this_thread::sleep_until(start + chrono::duration_cast<Clock::duration>(
+                chrono::duration<double>((number - 1) / load.rate)));
+
+        for (auto client = first; client < last; ++client) {
+            const auto command = "c" + to_string(client) + '.' + to_string(number) + '.' + to_string(now_ns());
+            const auto wrap = load.explicit_every != 0 && number % load.explicit_every == 0;
+            data = wrap ? "{\n" + command + "\n}\n" : command + '\n';
+            write_all(fds[client - first], data);
+        }
+    }
+
+    for (auto fd : fds)
+        close(fd);
+}
+
+// reads "bulk: c1.1.123, c2.1.124" lines of server output
+class LatencyMeter {
+public:
+    explicit LatencyMeter(size_t expected) : expected_(expected) {}
+
+    // returns when all commands are seen, input is ended or
+    // nothing comes during drain timeout after senders are done
+    void run(const atomic<bool>& sent) {
+        char buffer[64 << 10];
+        auto idle_since = Clock::now();
+        while (nreceived_ < expected_) {
+            pollfd pfd { STDIN_FILENO, POLLIN, 0 };
+            if (poll(&pfd, 1, 100) <= 0) {
+                if (sent && Clock::now() - idle_since > c_drain_timeout)
+                    return;
+                continue;
+            }
+
+            const auto n = read(STDIN_FILENO, buffer, sizeof(buffer));
+            if (n <= 0)
+                return;
+            idle_since = Clock::now();
+            input(string_view { buffer, static_cast<size_t>(n) });
+        }
+    }
+
+    size_t nreceived() const { return nreceived_; }
+    const Histogram& latencies() const { return latencies_; }
+
+private:
+    void input(string_view data) {
+        for (auto nl = data.find('\n'); nl != string_view::npos; nl = data.find('\n')) {
+            partial_.append(data.data(), nl);
+            handle_line(partial_);
+            partial_.clear();
+            data.remove_prefix(nl + 1);
+        }
+        partial_.append(data.data(), data.size());
+    }
+
+    void handle_line(string_view line) {
+        constexpr string_view prefix = "bulk: ";
+        if (line.compare(0, prefix.size(), prefix) != 0)
+            return;
+        line.remove_prefix(prefix.size());
+
+        const auto now = now_ns();
+        while (!line.empty()) {
+            const auto comma = line.find(", ");
+            const auto command = line.substr(0, comma);
+            const auto dot = command.rfind('.');
+            if (dot != string_view::npos) {
+                const auto sent = strtoull(string { command.substr(dot + 1) }.c_str(), nullptr, 10);
+                latencies_.record(now > sent ? (now - sent) / 1000 : 0);
+                ++nreceived_;
+            }
+            line.remove_prefix(comma == string_view::npos ? line.size() : comma + 2);
+        }
+    }
+
+    const size_t expected_;
+    size_t nreceived_ { 0 };
+    string partial_;
+    Histogram latencies_;   // microseconds
+};
+
+} // unnamed namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Usage: bulkmt_loadgen <address> [nclients] [ncommands] [rate] [explicit_every] [nthreads]" << endl;
+        return 1;
+    }
+
+    Load load;
+    const auto address = parse_socket_address(argv[1]);
+    load.nclients = argc > 2 ? stoul(argv[2]) : 100u;
+    load.ncommands = argc > 3 ? stoul(argv[3]) : 1000u;
+    load.rate = argc > 4 ? stod(argv[4]) : 0.;
+    load.explicit_every = argc > 5 ? stoul(argv[5]) : 0u;
+    const size_t nthreads = min<size_t>(argc > 6 ? stoul(argv[6]) : max(thread::hardware_concurrency(), 1u),
+                                        max<size_t>(load.nclients, 1u));
+
+    const auto total = load.nclients * load.ncommands;
+    const bool measure_latency = !isatty(STDIN_FILENO);
+    cout << "clients - " << load.nclients << "; commands per client - " << load.ncommands
+         << "; rate - " << load.rate << "; threads - " << nthreads << endl;
+
+    atomic<bool> sent { false };
+    LatencyMeter meter { total };
+    thread receiver;
+    if (measure_latency)
+        receiver = thread { [&meter, &sent] { meter.run(sent); } };
+
+    const auto start = Clock::now();
+    vector<thread> senders;
+    for (size_t i = 0; i < nthreads; ++i) {
+        const auto first = load.nclients * i / nthreads;
+        const auto last = load.nclients * (i + 1) / nthreads;
+        senders.emplace_back([&, first, last] { send_commands(address, load, first, last); });
+    }
+    for (auto& t : senders)
+        t.join();
+    const auto elapsed = chrono::duration<double>(Clock::now() - start).count();
+    sent = true;
+
+    cout << "sent - " << total << "; seconds - " << fixed << setprecision(3) << elapsed
+         << "; commands/s - " << setprecision(0) << total / elapsed << endl;
+
+    if (!measure_latency)
+        return 0;
+
+    receiver.join();
+    const auto& latencies = meter.latencies();
+    cout << "received - " << meter.nreceived() << "; missing - " << total - meter.nreceived() << endl;
+    cout << "latency, us: p50 - " << latencies.percentile(50)
+         << "; p90 - " << latencies.percentile(90)
+         << "; p99 - " << latencies.percentile(99)
+         << "; max - " << latencies.max() << endl;
+    return 0;
+}
\ No newline at end of file
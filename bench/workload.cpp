@@ -0,0 +1,216 @@
+// Generator of bulkmt input. The stream depends on options and seed only:
+// random numbers are produced by splitmix64 and distributions are computed
+// here, so the same seed gives the same bytes with any standard library.
+//
+//   bulkmt_workload --commands 1000000 --explicit-ratio 0.1 --max-depth 3 > workload.txt
+//   bulkmt_workload --rate 5000 | bulkmt 10 --max-block-age 100
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+using namespace std;
+
+namespace po = boost::program_options;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct Workload {
+    uint64_t seed { 1 };
+    size_t ncommands { 100000 };
+    string length_dist { "uniform" };   // fixed | uniform | exponential
+    size_t min_length { 4 };
+    size_t max_length { 32 };
+    size_t mean_length { 12 };          // of exponential distribution
+    double explicit_ratio { 0.1 };      // probability of opening explicit block instead of command
+    size_t explicit_size { 10 };        // mean number of commands in explicit block
+    size_t max_depth { 1 };
+    bool unterminated { false };        // explicit blocks open at the end aren't closed
+    double rate { 0 };                  // commands per second, 0 - unlimited
+};
+
+class Random {
+public:
+    explicit Random(uint64_t seed) : state_(seed) {}
+
+    uint64_t next() {
+        auto z = (state_ += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    // [0, 1)
+    double uniform() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+
+    // [min, max]
+    size_t uniform(size_t min, size_t max) {
+        return min + static_cast<size_t>(uniform() * static_cast<double>(max - min + 1));
+    }
+
+    bool chance(double p) { return uniform() < p; }
+
+    // number of trials up to the first success, mean is given
+    size_t geometric(double mean) {
+        if (mean <= 1)
+            return 1;
+        return 1 + static_cast<size_t>(std::log(1 - uniform()) / std::log(1 - 1 / mean));
+    }
+
+private:
+    uint64_t state_;
+};
+
+class Generator {
+public:
+    explicit Generator(const Workload& workload) : workload_(workload), random_(workload.seed) {}
+
+    // appends the next line; returns false when the stream is over
+    bool next(string& out) {
+        if (ncommands_ == workload_.ncommands) {
+            if (workload_.unterminated || remaining_.empty())
+                return false;
+            close_block(out);
+            return true;
+        }
+
+        if (!remaining_.empty() && remaining_.back() == 0) {
+            close_block(out);
+            return true;
+        }
+        if (remaining_.size() < workload_.max_depth && random_.chance(workload_.explicit_ratio)) {
+            remaining_.push_back(random_.geometric(static_cast<double>(workload_.explicit_size)));
+            out += "{\n";
+            return true;
+        }
+
+        if (!remaining_.empty())
+            --remaining_.back();
+        command(out);
+        return true;
+    }
+
+    size_t ncommands() const { return ncommands_; }
+
+private:
+    void close_block(string& out) {
+        remaining_.pop_back();
+        out += "}\n";
+    }
+
+    size_t length() {
+        const auto min = workload_.min_length;
+        const auto max = std::max(workload_.max_length, min);
+        if (workload_.length_dist == "fixed")
+            return min;
+        if (workload_.length_dist == "exponential") {
+            const auto mean = static_cast<double>(std::max<size_t>(workload_.mean_length, 1u));
+            const auto value = static_cast<size_t>(-std::log(1 - random_.uniform()) * mean);
+            return std::clamp(value, min, max);
+        }
+        return random_.uniform(min, max);
+    }
+
+    // command is its number padded by letters, so it's never a brace
+    void command(string& out) {
+        const auto number = "c" + to_string(ncommands_++);
+        const auto size = std::max(length(), number.size());
+        out += number;
+        for (auto i = number.size(); i < size; ++i)
+            out += static_cast<char>('a' + random_.next() % 26);
+        out += '\n';
+    }
+
+    const Workload& workload_;
+    Random random_;
+    size_t ncommands_ { 0 };
+    vector<size_t> remaining_;  // commands left in open explicit blocks
+};
+
+void write(const string& data) {
+    if (fwrite(data.data(), 1, data.size(), stdout) != data.size()) {
+        perror("write");
+        exit(1);
+    }
+}
+
+} // unnamed namespace
+
+int main(int argc, char* argv[]) {
+    Workload w;
+
+    po::options_description options { "Options" };
+    options.add_options()
+        ("help,h", "print this help")
+        ("seed", po::value(&w.seed)->default_value(w.seed), "seed of random numbers")
+        ("commands", po::value(&w.ncommands)->default_value(w.ncommands), "number of commands")
+        ("length-dist", po::value(&w.length_dist)->default_value(w.length_dist),
+            "distribution of command length: fixed | uniform | exponential")
+        ("min-length", po::value(&w.min_length)->default_value(w.min_length), "minimum command length")
+        ("max-length", po::value(&w.max_length)->default_value(w.max_length), "maximum command length")
+        ("mean-length", po::value(&w.mean_length)->default_value(w.mean_length),
+            "mean command length of exponential distribution")
+        ("explicit-ratio", po::value(&w.explicit_ratio)->default_value(w.explicit_ratio),
+            "probability of opening explicit block in place of command")
+        ("explicit-size", po::value(&w.explicit_size)->default_value(w.explicit_size),
+            "mean number of commands in explicit block")
+        ("max-depth", po::value(&w.max_depth)->default_value(w.max_depth),
+            "maximum nesting of explicit blocks; 0 - dynamic blocks only")
+        ("unterminated", po::bool_switch(&w.unterminated), "leave explicit blocks open at the end")
+        ("rate", po::value(&w.rate)->default_value(w.rate), "commands per second; 0 - unlimited");
+
+    try {
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, options), vm);
+        if (vm.count("help")) {
+            cout << "Usage: bulkmt_workload [options]" << endl << options;
+            return 0;
+        }
+        po::notify(vm);
+        if (w.length_dist != "fixed" && w.length_dist != "uniform" && w.length_dist != "exponential")
+            throw po::invalid_option_value(w.length_dist);
+    } catch (const po::error& e) {
+        cerr << e.what() << endl << options;
+        return 1;
+    }
+
+    Generator generator { w };
+    string buffer;
+    if (w.rate <= 0) {
+        while (generator.next(buffer)) {
+            if (buffer.size() >= 64u << 10) {
+                write(buffer);
+                buffer.clear();
+            }
+        }
+        write(buffer);
+        return 0;
+    }
+
+    // commands are written by batches of about 10 ms each on schedule
+    const auto batch = max<size_t>(static_cast<size_t>(w.rate / 100), 1u);
+    const auto start = Clock::now();
+    auto more = true;
+    while (more) {
+        const auto first = generator.ncommands();
+        while ((more = generator.next(buffer)) && generator.ncommands() - first < batch);
+        write(buffer);
+        fflush(stdout);
+        buffer.clear();
+
+        const auto due = start + chrono::duration_cast<Clock::duration>(
+            chrono::duration<double>(static_cast<double>(generator.ncommands()) / w.rate));
+        this_thread::sleep_until(due);
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "affinity.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace griha {
+
+namespace {
+
+constexpr auto c_nodes_dir = "/sys/devices/system/node/";
+
+unsigned parse_cpu(const std::string& list, const std::string& value) {
+    if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos)
+        throw std::invalid_argument { "bad CPU list: " + list };
+    const auto cpu = std::stoul(value);
+    if (cpu >= CPU_SETSIZE)
+        throw std::invalid_argument { "CPU number is too big: " + value };
+    return static_cast<unsigned>(cpu);
+}
+
+CpuSet online_cpus() {
+    std::ifstream online { std::string { "/sys/devices/system/cpu/online" } };
+    std::string list;
+    if (std::getline(online, list) && !list.empty())
+        return parse_cpu_list(list);
+
+    CpuSet result;
+    const auto ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    for (auto cpu = 0l; cpu < ncpus; ++cpu)
+        result.push_back(static_cast<unsigned>(cpu));
+    return result;
+}
+
+} // unnamed namespace
+
+CpuSet parse_cpu_list(const std::string& list) {
+    CpuSet result;
+    size_t begin = 0;
+    while (begin <= list.size()) {
+        auto end = list.find(',', begin);
+        if (end == std::string::npos)
+            end = list.size();
+        const auto item = list.substr(begin, end - begin);
+        const auto dash = item.find('-');
+        if (dash == std::string::npos) {
+            result.push_back(parse_cpu(list, item));
+        } else {
+            const auto first = parse_cpu(list, item.substr(0, dash));
+            const auto last = parse_cpu(list, item.substr(dash + 1));
+            if (first > last)
+                throw std::invalid_argument { "bad CPU list: " + list };
+            for (auto cpu = first; cpu <= last; ++cpu)
+                result.push_back(cpu);
+        }
+        begin = end + 1;
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+size_t numa_nodes() {
+    size_t n = 0;
+    while (std::ifstream { c_nodes_dir + ("node" + std::to_string(n)) + "/cpulist" })
+        ++n;
+    return std::max<size_t>(n, 1u);
+}
+
+CpuSet numa_node_cpus(int node) {
+    std::ifstream cpulist { c_nodes_dir + ("node" + std::to_string(node)) + "/cpulist" };
+    std::string list;
+    if (cpulist && std::getline(cpulist, list) && !list.empty())
+        return parse_cpu_list(list);
+    // kernel without NUMA support shows no nodes
+    if (node == 0 && !std::ifstream { c_nodes_dir + std::string { "node0/cpulist" } })
+        return online_cpus();
+    throw std::invalid_argument { "no CPUs on NUMA node " + std::to_string(node) };
+}
+
+int cpu_node(unsigned cpu) {
+    const auto nnodes = static_cast<int>(numa_nodes());
+    for (auto node = 0; node < nnodes; ++node) {
+        const auto cpus = numa_node_cpus(node);
+        if (std::binary_search(cpus.begin(), cpus.end(), cpu))
+            return node;
+    }
+    return -1;
+}
+
+void check_affinity(const AffinityOptions& affinity) {
+    if (affinity.numa_node < 0)
+        return;
+
+    // reader may be elsewhere, it allocates blocks on the node anyway
+    const auto node_cpus = numa_node_cpus(affinity.numa_node);
+    for (auto cpu : affinity.executor)
+        if (!std::binary_search(node_cpus.begin(), node_cpus.end(), cpu))
+            throw std::invalid_argument { "CPU " + std::to_string(cpu) + " isn't on NUMA node "
+                                          + std::to_string(affinity.numa_node) };
+}
+
+int memory_node(const AffinityOptions& affinity) {
+    if (affinity.numa_node >= 0)
+        return affinity.numa_node;
+    if (!affinity.executor.empty())
+        return cpu_node(affinity.executor.front());
+    return -1;
+}
+
+void prefer_node_memory(int node) {
+    constexpr size_t c_bits = sizeof(unsigned long) * CHAR_BIT;
+    const auto n = static_cast<size_t>(node);
+    std::vector<unsigned long> mask(n / c_bits + 1, 0);
+    mask[n / c_bits] |= 1ul << (n % c_bits);
+
+    // kernel counts one bit less than maxnode
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask.data(), mask.size() * c_bits + 1) != 0
+            && errno != ENOSYS) // kernel without NUMA has local memory only
+        throw std::system_error { errno, std::generic_category(), "can't set memory policy" };
+}
+
+void pin_thread(pthread_t thread, const CpuSet& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto cpu : cpus)
+        CPU_SET(cpu, &set);
+
+    const auto error = pthread_setaffinity_np(thread, sizeof(set), &set);
+    if (error != 0)
+        throw std::system_error { error, std::generic_category(), "can't set thread affinity" };
+}
+
+void pin_current_thread(const CpuSet& cpus) {
+    pin_thread(pthread_self(), cpus);
+}
+
+} // namespace griha
\ No newline at end of file
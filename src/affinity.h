@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+namespace griha {
+
+// CPU numbers in ascending order without duplicates
+using CpuSet = std::vector<unsigned>;
+
+// Placement of threads and memory of blocks. Input chunks and blocks are
+// allocated by the reader, its memory is taken from the node of consuming
+// executor threads, so sinks read blocks locally even if the reader runs on
+// other node. Pages of regular files being in page cache already stay where
+// they are.
+struct AffinityOptions {
+    CpuSet reader;          // empty - reader thread isn't pinned
+    CpuSet executor;        // executor threads are pinned to these CPUs one by one
+    int numa_node { -1 };   // executor threads and memory of blocks are kept on the node,
+                            // so is the reader unless it has CPUs
+};
+
+// parses list like "0-3,8,10-11"; throws std::invalid_argument
+CpuSet parse_cpu_list(const std::string& list);
+
+// number of NUMA nodes; a machine without NUMA has one node
+size_t numa_nodes();
+// throws std::invalid_argument if there is no such node
+CpuSet numa_node_cpus(int node);
+
+// NUMA node of the CPU, -1 if it isn't online
+int cpu_node(unsigned cpu);
+
+// CPUs of executor belong to the NUMA node if it's given;
+// throws std::invalid_argument
+void check_affinity(const AffinityOptions& affinity);
+
+// node of consuming threads: the given one or the node of the first
+// executor CPU; -1 - consumers aren't placed
+int memory_node(const AffinityOptions& affinity);
+
+// pages touched first by the calling thread and threads created by it later
+// are taken from the node while it has free memory; throws std::system_error
+void prefer_node_memory(int node);
+
+// throws std::system_error
+void pin_thread(pthread_t thread, const CpuSet& cpus);
+void pin_current_thread(const CpuSet& cpus);
+
+} // namespace griha
\ No newline at end of file
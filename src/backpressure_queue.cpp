@@ -0,0 +1,100 @@
+#include "backpressure_queue.h"
+
+#include <utility>
+
+#include "block.h"
+#include "spill_file.h"
+
+namespace griha {
+
+BackpressureQueue::BackpressureQueue(std::unique_ptr<BlockQueue> queue, Overflow overflow,
+                                     const std::string& spill_dir)
+    : queue_(std::move(queue))
+    , overflow_(overflow) {
+    if (overflow_ == Overflow::spill)
+        spill_ = std::make_unique<SpillFile>(spill_dir);
+}
+
+BackpressureQueue::~BackpressureQueue() = default;
+
+void BackpressureQueue::push(BlockPtr block) {
+    switch (overflow_) {
+    case Overflow::block:
+        queue_->push(std::move(block));
+        break;
+
+    case Overflow::drop_oldest:
+        while (!queue_->try_push(block)) {
+            BlockPtr dropped;
+            if (queue_->try_pop_oldest(dropped))
+                ndropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        break;
+
+    case Overflow::spill: {
+        std::lock_guard<std::mutex> l { spill_guard_ };
+        if (replay_error_)
+            std::rethrow_exception(std::exchange(replay_error_, nullptr));
+        replay();
+        // order of blocks is kept: while something is spilled new blocks go to the file
+        if (!spill_->empty() || !queue_->try_push(block)) {
+            spill_->push(*block);
+            nspilled_.fetch_add(1, std::memory_order_relaxed);
+            nspilled_now_.store(spill_->size(), std::memory_order_relaxed);
+        }
+        break;
+    }
+    }
+
+    update_high_water();
+}
+
+void BackpressureQueue::replay_by_consumer() {
+    std::unique_lock<std::mutex> l { spill_guard_, std::try_to_lock };
+    if (!l.owns_lock() || replay_error_)
+        return;
+    try {
+        replay();
+    } catch (...) {
+        replay_error_ = std::current_exception();
+    }
+}
+
+void BackpressureQueue::replay() {
+    while (!spill_->empty()) {
+        auto block = spill_->front();
+        if (!queue_->try_push(block))
+            break;
+        spill_->pop();
+    }
+    nspilled_now_.store(spill_->size(), std::memory_order_relaxed);
+}
+
+void BackpressureQueue::close() {
+    if (spill_) {
+        std::lock_guard<std::mutex> l { spill_guard_ };
+        while (!spill_->empty()) {
+            queue_->push(spill_->front());
+            spill_->pop();
+        }
+        nspilled_now_.store(0, std::memory_order_relaxed);
+    }
+    queue_->close();
+}
+
+void BackpressureQueue::update_high_water() {
+    const auto depth = queue_->size() + nspilled_now_.load(std::memory_order_relaxed);
+    if (depth > high_water_.load(std::memory_order_relaxed))
+        high_water_.store(depth, std::memory_order_relaxed);
+}
+
+auto BackpressureQueue::metrics() const -> Metrics {
+    return {
+        queue_->size() + nspilled_now_.load(std::memory_order_relaxed),
+        high_water_.load(std::memory_order_relaxed),
+        ndropped_.load(std::memory_order_relaxed),
+        nspilled_.load(std::memory_order_relaxed)
+    };
+}
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "block_queue.h"
+
+namespace griha {
+
+class SpillFile;
+
+// What the reader does when queue of a subscriber is full
+enum class Overflow {
+    block,          // wait until a block is taken from the queue
+    drop_oldest,    // drop the oldest queued block
+    spill           // store the block into overflow file and replay it later
+};
+
+// Bounded queue of a subscriber that applies overflow policy.
+// It's filled by the reader thread only; spilled blocks are moved back
+// into the queue when it has room: on next push, when consumers take
+// blocks and at closing.
+class BackpressureQueue {
+public:
+    struct Metrics {
+        size_t depth;       // blocks queued including spilled ones
+        size_t high_water;  // maximum depth
+        size_t ndropped;
+        size_t nspilled;
+    };
+
+public:
+    BackpressureQueue(std::unique_ptr<BlockQueue> queue, Overflow overflow,
+                      const std::string& spill_dir = ".");
+    ~BackpressureQueue();
+
+    BackpressureQueue(const BackpressureQueue&) = delete;
+    BackpressureQueue& operator= (const BackpressureQueue&) = delete;
+
+    void push(BlockPtr block);
+
+    bool pop(size_t thread_index, BlockPtr& block, bool& stolen) {
+        try_replay();
+        return queue_->pop(thread_index, block, stolen);
+    }
+
+    bool try_pop(size_t thread_index, BlockPtr& block, bool& stolen) {
+        try_replay();
+        return queue_->try_pop(thread_index, block, stolen);
+    }
+
+    // replays spilled blocks and closes the queue
+    void close();
+
+    Metrics metrics() const;
+    size_t capacity() const { return queue_->capacity(); }
+    bool empty() const {
+        return queue_->size() == 0 && nspilled_now_.load(std::memory_order_relaxed) == 0;
+    }
+
+private:
+    // consumers replay spilled blocks unless the reader is at it; error of
+    // replaying is rethrown to the reader by the next push
+    void try_replay() {
+        if (nspilled_now_.load(std::memory_order_relaxed) != 0)
+            replay_by_consumer();
+    }
+    void replay_by_consumer();
+    // spill guard is held
+    void replay();
+    void update_high_water();
+
+    std::unique_ptr<BlockQueue> queue_;
+    const Overflow overflow_;
+    std::mutex spill_guard_;    // spill file is used by the reader and consumers
+    std::unique_ptr<SpillFile> spill_;
+    std::exception_ptr replay_error_;
+
+    std::atomic<size_t> nspilled_now_ { 0 };
+    std::atomic<size_t> high_water_ { 0 };
+    std::atomic<size_t> ndropped_ { 0 };
+    std::atomic<size_t> nspilled_ { 0 };
+};
+
+} // namespace griha
\ No newline at end of file
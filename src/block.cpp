@@ -0,0 +1,136 @@
+#include "block.h"
+
+#include <cstring>
+#include <new>
+
+#include "chunk_reader.h"
+
+namespace griha {
+
+namespace {
+
+// Allocates shared object with extra tail bytes by single allocation.
+// Pointer to the tail is stored into the variable supplied by the caller.
+template <typename T>
+struct TailAllocator {
+    using value_type = T;
+
+    size_t tail_size;
+    char** tail;
+
+    TailAllocator(size_t size, char** t) : tail_size(size), tail(t) {}
+
+    template <typename U>
+    TailAllocator(const TailAllocator<U>& other)
+        : tail_size(other.tail_size), tail(other.tail) {}
+
+    T* allocate(size_t n) {
+        const auto size = n * sizeof(T);
+        auto p = static_cast<char*>(::operator new(size + tail_size));
+        *tail = p + size;
+        return reinterpret_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t) noexcept {
+        ::operator delete(p);
+    }
+};
+
+template <typename T, typename U>
+inline bool operator== (const TailAllocator<T>& lhs, const TailAllocator<U>& rhs) {
+    return lhs.tail == rhs.tail;
+}
+
+template <typename T, typename U>
+inline bool operator!= (const TailAllocator<T>& lhs, const TailAllocator<U>& rhs) {
+    return !(lhs == rhs);
+}
+
+} // unnamed namespace
+
+void BlockBuilder::append(std::string_view line, const InputChunkPtr& chunk) {
+    if (empty())
+        created_ = std::chrono::steady_clock::now();
+
+    const auto line_end = line.data() + line.size();
+    const auto terminated = chunk
+        && line_end < chunk->data() + chunk->size()
+        && *line_end == '\n';
+
+    if (terminated && (empty() || (chunk_ == chunk && line.data() == view_end_))) {
+        // line is adjacent to previous one - just extend the view
+        if (empty()) {
+            chunk_ = chunk;
+            view_begin_ = line.data();
+        }
+        view_end_ = line_end + 1;
+
+        const auto capacity = offsets_.capacity();
+        offsets_.push_back(static_cast<size_t>(view_end_ - view_begin_));
+        nallocations_ += capacity != offsets_.capacity();
+        return;
+    }
+
+    if (chunk_) {
+        // statements aren't adjacent anymore - switch to copying
+        const auto capacity = bytes_.capacity();
+        bytes_.assign(view_begin_, view_end_);
+        nallocations_ += capacity != bytes_.capacity();
+        chunk_.reset();
+    }
+
+    append_copy(line);
+}
+
+void BlockBuilder::append_copy(std::string_view line) {
+    const auto capacity = offsets_.capacity() + bytes_.capacity();
+
+    bytes_.append(line.data(), line.size());
+    bytes_.push_back('\n');
+    offsets_.push_back(bytes_.size());
+
+    nallocations_ += capacity != offsets_.capacity() + bytes_.capacity();
+}
+
+BlockPtr BlockBuilder::build(uint64_t id) {
+    return build(id, created_, std::chrono::steady_clock::now());
+}
+
+BlockPtr BlockBuilder::build(uint64_t id, Block::TimePoint created, Block::TimePoint published) {
+    if (empty())
+        return std::make_shared<const Block>();
+
+    const auto copied = chunk_ == nullptr;
+    const auto offsets_size = offsets_.size() * sizeof(size_t);
+    const auto bytes_size = copied ? bytes_.size() : 0u;
+
+    // block, offsets and copied values are placed into single allocation
+    char* tail = nullptr;
+    auto block = std::allocate_shared<Block>(
+        TailAllocator<Block> { offsets_size + bytes_size, &tail });
+    ++nallocations_;
+
+    std::memcpy(tail, offsets_.data(), offsets_size);
+    if (copied)
+        std::memcpy(tail + offsets_size, bytes_.data(), bytes_size);
+
+    block->chunk_ = std::move(chunk_);
+    block->bytes_ = copied ? tail + offsets_size : view_begin_;
+    block->offsets_ = reinterpret_cast<const size_t*>(tail);
+    block->count_ = offsets_.size() - 1;
+    block->id_ = id;
+    block->created_ = created;
+    block->published_ = published;
+
+    clear();
+    return block;
+}
+
+void BlockBuilder::clear() {
+    offsets_.resize(1);
+    bytes_.clear();
+    chunk_.reset();
+    view_begin_ = view_end_ = nullptr;
+}
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "forward.h"
+
+namespace griha {
+
+// Immutable flat block of statements. Values of statements are stored one
+// after another in contiguous byte buffer, each value is followed by new line
+// symbol. Offsets array has size() + 1 entries, i-th statement occupies
+// bytes [offsets[i], offsets[i + 1] - 1).
+// Block is published once by the reader and is shared by all subscribers
+// by pointer, it's released when the last consumer has finished with it.
+class Block {
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = std::string_view;
+
+        const_iterator() = default;
+
+        std::string_view operator* () const { return (*block_)[index_]; }
+        const_iterator& operator++ () { ++index_; return *this; }
+        const_iterator operator++ (int) { auto tmp = *this; ++index_; return tmp; }
+
+        bool operator== (const const_iterator& other) const { return index_ == other.index_; }
+        bool operator!= (const const_iterator& other) const { return index_ != other.index_; }
+
+    private:
+        friend class Block;
+        template <typename Kind> friend class StatementBatch;
+        const_iterator(const Block* block, size_t index) : block_(block), index_(index) {}
+
+        const Block* block_ { nullptr };
+        size_t index_ { 0 };
+    };
+
+public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+public:
+    Block() = default;
+
+    Block(const Block&) = delete;
+    Block& operator= (const Block&) = delete;
+
+    // sequence number of block assigned by the reader
+    uint64_t id() const { return id_; }
+    // time of appending the first statement
+    TimePoint created() const { return created_; }
+    // time of building the block, subscribers get it right after that
+    TimePoint published() const { return published_; }
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+    std::string_view operator[] (size_t i) const {
+        return { bytes_ + offsets_[i], offsets_[i + 1] - offsets_[i] - 1 };
+    }
+
+    // all statements of the block, each is terminated by new line symbol
+    std::string_view bytes() const {
+        return count_ == 0 ? std::string_view {} : std::string_view { bytes_, offsets_[count_] };
+    }
+
+    const_iterator begin() const { return { this, 0 }; }
+    const_iterator end() const { return { this, count_ }; }
+
+private:
+    friend class BlockBuilder;
+
+    InputChunkPtr chunk_; // is null if values have been copied into the block
+    const char* bytes_ { nullptr };
+    const size_t* offsets_ { nullptr };
+    size_t count_ { 0 };
+    uint64_t id_ { 0 };
+    TimePoint created_;
+    TimePoint published_;
+};
+
+// Accumulates statements of a block. Consecutive lines of the same input
+// chunk are referred without copying, otherwise values are copied into
+// the block storage. Internal buffers are reused between blocks.
+class BlockBuilder {
+public:
+    BlockBuilder() = default;
+
+    BlockBuilder(const BlockBuilder&) = delete;
+    BlockBuilder& operator= (const BlockBuilder&) = delete;
+
+    // chunk is null if line doesn't belong to any chunk
+    void append(std::string_view line, const InputChunkPtr& chunk);
+
+    size_t size() const { return offsets_.size() - 1; }
+    bool empty() const { return offsets_.size() == 1; }
+
+    // makes block from accumulated statements and resets the builder
+    BlockPtr build(uint64_t id = 0);
+    // block being restored keeps its times
+    BlockPtr build(uint64_t id, Block::TimePoint created, Block::TimePoint published);
+    void clear();
+
+    // number of heap allocations performed by the builder
+    size_t nallocations() const { return nallocations_; }
+
+private:
+    void append_copy(std::string_view line);
+
+    std::vector<size_t> offsets_ { 0 };
+    std::string bytes_;
+
+    // bytes of input chunk referred by the block being built
+    InputChunkPtr chunk_;
+    const char* view_begin_ { nullptr };
+    const char* view_end_ { nullptr };
+    Block::TimePoint created_;
+
+    size_t nallocations_ { 0 };
+};
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+
+#include "forward.h"
+#include "mpmc_queue.h"
+
+namespace griha {
+
+// Queue of blocks between the reader and threads of a subscriber.
+// Each consumer thread identifies itself by index in range [0, nthreads).
+struct BlockQueue {
+    virtual ~BlockQueue() {}
+
+    // waits while queue is full
+    virtual void push(BlockPtr block) = 0;
+    // waits for a block; returns false if queue is closed and empty;
+    // stolen is set if the block has been taken from another thread
+    virtual bool pop(size_t thread_index, BlockPtr& block, bool& stolen) = 0;
+    virtual void close() = 0;
+
+    // non-blocking versions; block isn't moved out if push fails
+    virtual bool try_push(BlockPtr& block) = 0;
+    virtual bool try_pop(size_t thread_index, BlockPtr& block, bool& stolen) = 0;
+    // takes the earliest pushed of queued blocks, it's used for dropping them
+    virtual bool try_pop_oldest(BlockPtr& block) = 0;
+
+    virtual size_t size() const = 0;
+    virtual size_t capacity() const = 0;
+};
+
+// All threads take blocks from single lock-free ring buffer
+class RingBlockQueue : public BlockQueue {
+public:
+    explicit RingBlockQueue(size_t capacity = c_default_queue_capacity)
+        : queue_(capacity) {}
+
+    void push(BlockPtr block) override { queue_.push(std::move(block)); }
+
+    bool pop(size_t, BlockPtr& block, bool& stolen) override {
+        stolen = false;
+        return queue_.pop(block);
+    }
+
+    void close() override { queue_.close(); }
+
+    bool try_push(BlockPtr& block) override { return queue_.try_push(block); }
+
+    bool try_pop(size_t, BlockPtr& block, bool& stolen) override {
+        stolen = false;
+        return queue_.try_pop(block);
+    }
+
+    bool try_pop_oldest(BlockPtr& block) override { return queue_.try_pop(block); }
+
+    size_t size() const override { return queue_.size(); }
+    size_t capacity() const override { return queue_.capacity(); }
+
+private:
+    MpmcQueue<BlockPtr> queue_;
+};
+
+} // namespace griha
\ No newline at end of file
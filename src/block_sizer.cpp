@@ -0,0 +1,37 @@
+#include "block_sizer.h"
+
+#include <algorithm>
+
+namespace griha {
+
+AdaptiveBlockSizer::AdaptiveBlockSizer(const AdaptiveOptions& options, LoadProbe probe)
+    : min_size_(std::max<size_t>(options.min_size, 1u))
+    , max_size_(std::max(options.max_size, min_size_))
+    , probe_(std::move(probe))
+    , last_sample_(Clock::now()) {}
+
+size_t AdaptiveBlockSizer::next_size(size_t current) {
+    current = std::clamp(current, min_size_, max_size_);
+    if (++nblocks_ % c_sample_period != 0)
+        return current;
+
+    const auto load = probe_();
+    const auto now = Clock::now();
+    const auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_sample_).count();
+    const auto busy_ns = load.busy_ns - last_busy_ns_;
+    last_sample_ = now;
+    last_busy_ns_ = load.busy_ns;
+
+    // share of time threads have been handling blocks since previous sample
+    const auto utilization = elapsed_ns > 0 && load.nthreads != 0
+        ? static_cast<double>(busy_ns) / static_cast<double>(elapsed_ns) / static_cast<double>(load.nthreads)
+        : 0.;
+
+    if (load.depth * 2 >= load.capacity || utilization >= c_high_utilization)
+        return std::min(current * 2, max_size_);
+    if (load.depth == 0 && utilization < c_low_utilization)
+        return std::max(current / 2, min_size_);
+    return current;
+}
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace griha {
+
+// Chooses the size limit of dynamic blocks while reading
+struct BlockSizer {
+    virtual ~BlockSizer() {}
+    // called by the reader after every dynamic block; returns limit of next blocks
+    virtual size_t next_size(size_t current) = 0;
+};
+
+using BlockSizerPtr = std::shared_ptr<BlockSizer>;
+
+struct AdaptiveOptions {
+    bool enabled { false };
+    size_t min_size { 1 };
+    size_t max_size { 1024 };
+};
+
+// State of the consumer of blocks sampled by adaptive sizer
+struct DownstreamLoad {
+    size_t depth;               // blocks waiting in queue
+    size_t capacity;            // of queue
+    uint64_t busy_ns;           // total time of handling blocks by all threads
+    size_t nthreads;
+};
+
+// Grows blocks when the consumer can't keep up, so per-bulk costs are
+// amortized, and shrinks them when it's idle, so statements don't wait
+// for a big block. Load is sampled every c_sample_period blocks: block size
+// is doubled if queue is half full or threads are busy most of the time
+// since previous sample and halved if queue is empty and threads are
+// mostly idle.
+class AdaptiveBlockSizer : public BlockSizer {
+public:
+    static constexpr size_t c_sample_period = 16;   // blocks
+    static constexpr double c_high_utilization = 0.8;
+    static constexpr double c_low_utilization = 0.4;
+
+    using LoadProbe = std::function<DownstreamLoad ()>;
+
+public:
+    AdaptiveBlockSizer(const AdaptiveOptions& options, LoadProbe probe);
+
+    size_t next_size(size_t current) override;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    const size_t min_size_;
+    const size_t max_size_;
+    LoadProbe probe_;
+
+    size_t nblocks_ { 0 };
+    Clock::time_point last_sample_;
+    uint64_t last_busy_ns_ { 0 };
+};
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include "chunk_reader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace griha {
+
+std::shared_ptr<InputChunk> InputChunk::allocate(size_t capacity) {
+    std::shared_ptr<InputChunk> chunk { new InputChunk };
+    chunk->data_ = new char[capacity];
+    chunk->capacity_ = capacity;
+    return chunk;
+}
+
+std::shared_ptr<InputChunk> InputChunk::map(int fd, size_t offset, size_t length) {
+    const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const auto aligned_offset = offset / page_size * page_size;
+    const auto mapping_length = length + (offset - aligned_offset);
+
+    auto addr = mmap(nullptr, mapping_length, PROT_READ, MAP_PRIVATE, fd,
+                     static_cast<off_t>(aligned_offset));
+    if (addr == MAP_FAILED)
+        return nullptr;
+    madvise(addr, mapping_length, MADV_SEQUENTIAL);
+
+    std::shared_ptr<InputChunk> chunk { new InputChunk };
+    chunk->mapping_ = addr;
+    chunk->mapping_length_ = mapping_length;
+    chunk->data_ = static_cast<char*>(addr) + (offset - aligned_offset);
+    chunk->size_ = chunk->capacity_ = length;
+    return chunk;
+}
+
+InputChunk::~InputChunk() {
+    if (mapping_ != nullptr)
+        munmap(mapping_, mapping_length_);
+    else
+        delete[] data_;
+}
+
+ChunkReader::ChunkReader(int fd, size_t chunk_size, ScanIsa isa)
+    : fd_(fd)
+    , chunk_size_(std::max<size_t>(chunk_size, 1u))
+    , isa_(is_supported(isa) ? isa : ScanIsa::scalar) {}
+
+bool ChunkReader::try_map() {
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode))
+        return false;
+
+    const auto offset = lseek(fd_, 0, SEEK_CUR);
+    if (offset < 0 || offset >= st.st_size)
+        return false;
+
+    const auto length = static_cast<size_t>(st.st_size - offset);
+    auto chunk = InputChunk::map(fd_, static_cast<size_t>(offset), length);
+    if (!chunk)
+        return false;
+
+    // leave descriptor in the same state as if the file has been read
+    lseek(fd_, 0, SEEK_END);
+
+    current_ = std::move(chunk);
+    chunk_ = current_;
+    pos_ = 0;
+    eof_ = true; // whole rest of the file is mapped
+    ++nchunks_;
+    return true;
+}
+
+bool ChunkReader::wait_input() {
+    using namespace std::chrono;
+
+    pollfd pfd { fd_, POLLIN, 0 };
+    while (true) {
+        const auto left = ceil<milliseconds>(deadline_ - steady_clock::now());
+        const auto n = poll(&pfd, 1, static_cast<int>(std::max<milliseconds::rep>(left.count(), 0)));
+        if (n < 0 && errno == EINTR)
+            continue;
+        // errors and hang up are reported by read
+        return n != 0;
+    }
+}
+
+void ChunkReader::refill() {
+    const char* carry = current_ ? current_->data() + pos_ : nullptr;
+    const size_t ncarry = current_ ? current_->size() - pos_ : 0;
+
+    std::shared_ptr<InputChunk> chunk;
+    if (current_ && current_->mapping_ == nullptr && current_->size() < current_->capacity()) {
+        // pipes return data by small portions - continue filling of current chunk;
+        // bytes behind its size aren't visible to holders of views
+        chunk = std::move(current_);
+        pos_ = static_cast<size_t>(carry - chunk->data());
+    } else {
+        // a line longer than chunk requires bigger chunk
+        auto capacity = chunk_size_;
+        while (capacity < ncarry * 2)
+            capacity *= 2;
+
+        chunk = InputChunk::allocate(capacity);
+        if (ncarry != 0)
+            std::memcpy(chunk->data_, carry, ncarry);
+        chunk->size_ = ncarry;
+        pos_ = 0;
+        ++nchunks_;
+    }
+
+    while (true) {
+        auto n = read(fd_, chunk->data_ + chunk->size_, chunk->capacity_ - chunk->size_);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            eof_ = true; // read error is treated as end of input as std::getline does
+        else
+            chunk->size_ += static_cast<size_t>(n);
+        break;
+    }
+
+    current_ = std::move(chunk);
+    chunk_ = current_;
+}
+
+bool ChunkReader::next_line(std::string_view& line) {
+    LineKind kind;
+    return next_line(line, kind);
+}
+
+bool ChunkReader::next_window(std::string_view& line, LineKind& kind) {
+    timed_out_ = false;
+    if (!started_) {
+        started_ = true;
+        spans_.resize(c_scan_window);
+        try_map();
+    }
+
+    size_t scan_from = pos_;
+    while (true) {
+        if (current_) {
+            const auto data = current_->data();
+            const auto begin = data + pos_;
+            const auto end = data + current_->size();
+            const auto from = data + scan_from;
+            // window bounds number of spans kept at once
+            const auto window_end = static_cast<size_t>(end - from) > c_scan_window ? from + c_scan_window : end;
+
+            nspans_ = scan_lines(isa_, begin, from, window_end, spans_.data());
+            next_span_ = 0;
+            if (nspans_ != 0) {
+                // all spans of the window refer to the current chunk
+                window_ = from;
+                line_begin_ = begin;
+                pos_ = static_cast<size_t>(from - data) + spans_[nspans_ - 1].end() + 1;
+                return next_line(line, kind);
+            }
+
+            if (window_end != end) {
+                // line is longer than window
+                scan_from = static_cast<size_t>(window_end - data);
+                continue;
+            }
+
+            if (eof_) {
+                if (begin == end)
+                    return false;
+                // the last line isn't terminated by new line symbol
+                line = std::string_view { begin, static_cast<size_t>(end - begin) };
+                kind = classify_line(line);
+                pos_ = current_->size();
+                return true;
+            }
+        } else if (eof_) {
+            return false;
+        }
+
+        if (deadline_ != c_no_deadline && !wait_input()) {
+            // partial line is scanned again by next call
+            timed_out_ = true;
+            return false;
+        }
+
+        // partial line has already been scanned
+        const auto scanned = current_ ? current_->size() - pos_ : 0;
+        refill();
+        scan_from = pos_ + scanned;
+    }
+}
+
+} // namespace griha
\ No newline at end of file
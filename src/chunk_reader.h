@@ -0,0 +1,110 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "forward.h"
+#include "line_scanner.h"
+
+namespace griha {
+
+constexpr size_t c_default_chunk_size = 1u << 20;
+constexpr auto c_no_deadline = std::chrono::steady_clock::time_point::max();
+
+// Refcounted piece of input. It is either a heap buffer filled by read(2)
+// or a memory mapped region of a regular file.
+class InputChunk {
+public:
+    static std::shared_ptr<InputChunk> allocate(size_t capacity);
+    static std::shared_ptr<InputChunk> map(int fd, size_t offset, size_t length);
+
+    ~InputChunk();
+
+    InputChunk(const InputChunk&) = delete;
+    InputChunk& operator= (const InputChunk&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+
+private:
+    InputChunk() = default;
+
+    friend class ChunkReader;
+
+    char* data_ { nullptr };
+    size_t size_ { 0 };
+    size_t capacity_ { 0 };
+
+    // mmap'ed regions are released by munmap, heap buffers by delete[]
+    void* mapping_ { nullptr };
+    size_t mapping_length_ { 0 };
+};
+
+// Splits input of file descriptor into lines without copying them.
+// Lines are returned as views into the current chunk. A line crossing
+// the end of a chunk is carried over to the beginning of the next one.
+// Chunk is scanned by windows: all lines of a window are found and
+// classified in one pass and then handed out one by one.
+// If deadline is set, reader doesn't wait for input longer than until the
+// deadline: next_line returns false and timed_out tells it from end of input.
+class ChunkReader {
+public:
+    explicit ChunkReader(int fd, size_t chunk_size = c_default_chunk_size,
+                         ScanIsa isa = best_scan_isa());
+
+    ChunkReader(const ChunkReader&) = delete;
+    ChunkReader& operator= (const ChunkReader&) = delete;
+
+    // has the same semantic as std::getline except the line is a view
+    // that is valid while the chunk returned by chunk() is alive
+    bool next_line(std::string_view& line);
+
+    bool next_line(std::string_view& line, LineKind& kind) {
+        if (next_span_ == nspans_)
+            return next_window(line, kind);
+
+        const auto span = spans_[next_span_++];
+        const auto end = window_ + span.end();
+        line = std::string_view { line_begin_, static_cast<size_t>(end - line_begin_) };
+        kind = span.kind();
+        line_begin_ = end + 1;
+        return true;
+    }
+
+    const InputChunkPtr& chunk() const { return chunk_; }
+
+    size_t nchunks() const { return nchunks_; }
+
+    void set_deadline(std::chrono::steady_clock::time_point deadline) { deadline_ = deadline; }
+    bool timed_out() const { return timed_out_; }
+
+private:
+    bool try_map();
+    bool wait_input();
+    void refill();
+    bool next_window(std::string_view& line, LineKind& kind);
+
+    int fd_;
+    size_t chunk_size_;
+    ScanIsa isa_;
+    std::shared_ptr<InputChunk> current_;
+    InputChunkPtr chunk_;
+    size_t pos_ { 0 };
+    size_t nchunks_ { 0 };
+    bool eof_ { false };
+    bool started_ { false };
+    std::chrono::steady_clock::time_point deadline_ { c_no_deadline };
+    bool timed_out_ { false };
+
+    // lines of scanned window not handed out yet
+    std::vector<LineSpan> spans_;
+    size_t nspans_ { 0 };
+    size_t next_span_ { 0 };
+    const char* window_ { nullptr };
+    const char* line_begin_ { nullptr };
+};
+
+} // namespace griha
\ No newline at end of file
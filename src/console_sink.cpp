@@ -0,0 +1,114 @@
+#include "console_sink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <system_error>
+
+#include <unistd.h>
+
+#include "block.h"
+#include "statement.h"
+
+namespace griha {
+
+namespace {
+
+// appends values of run separated by comma; new line symbols of run bytes
+// are replaced while the bytes are copied, so values aren't looked up one
+// by one
+template <typename Kind>
+void append_values(std::string& buffer, const StatementBatch<Kind>& batch) {
+    const auto bytes = batch.bytes();
+    const auto pos = buffer.size();
+    // separator is one symbol longer than new line, the last new line is dropped
+    buffer.resize(pos + bytes.size() + batch.size() - 2);
+
+    auto out = &buffer[pos];
+    auto in = bytes.data();
+    const auto end = in + bytes.size();
+    while (true) {
+        auto eol = static_cast<const char*>(std::memchr(in, '\n', static_cast<size_t>(end - in)));
+        out = std::copy(in, eol, out);
+        in = eol + 1;
+        if (in == end)
+            break;
+        *out++ = ',';
+        *out++ = ' ';
+    }
+}
+
+} // unnamed namespace
+
+ConsoleSink::ConsoleSink(const ConsoleOptions& options, int fd)
+    : options_(options)
+    , fd_(fd) {
+    buffer_.reserve(options_.flush_size);
+}
+
+// copy gets its own buffer
+ConsoleSink::ConsoleSink(const ConsoleSink& other)
+    : ConsoleSink(other.options_, other.fd_) {}
+
+ConsoleSink::~ConsoleSink() {
+    try {
+        flush();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void ConsoleSink::operator() (const Block& block) {
+    if (buffer_.empty())
+        first_buffered_ = std::chrono::steady_clock::now();
+
+    buffer_ += "bulk: ";
+    auto first = true;
+    visit_batches(block, [this, &first] (const auto& batch) {
+        if (!first)
+            buffer_ += ", ";
+        append_values(buffer_, batch);
+        first = false;
+    });
+    buffer_ += '\n';
+
+    switch (options_.flush) {
+    case ConsoleFlush::per_bulk:
+        flush();
+        break;
+    case ConsoleFlush::by_size:
+        if (buffer_.size() >= options_.flush_size)
+            flush();
+        break;
+    case ConsoleFlush::by_time:
+        if (expired())
+            flush();
+        break;
+    }
+}
+
+bool ConsoleSink::expired() const {
+    return std::chrono::steady_clock::now() - first_buffered_ >= options_.flush_interval;
+}
+
+void ConsoleSink::flush() {
+    auto data = buffer_.data();
+    auto size = buffer_.size();
+    while (size != 0) {
+        auto n = ::write(fd_, data, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) {
+            const auto error = errno;
+            buffer_.clear();
+            throw std::system_error { error, std::generic_category(), "can't write console output" };
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    // capacity is kept for next bulks
+    buffer_.clear();
+}
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "forward.h"
+
+namespace griha {
+
+// When console sink writes formatted bulks out
+enum class ConsoleFlush {
+    per_bulk,   // every bulk is written at once
+    by_size,    // buffer is written when it grows over flush size
+    by_time     // buffer is written when the oldest bulk waits longer than flush interval
+};
+
+struct ConsoleOptions {
+    ConsoleFlush flush { ConsoleFlush::per_bulk };
+    size_t flush_size { 64u << 10 };                  // bytes
+    std::chrono::milliseconds flush_interval { 100 };
+};
+
+// Log job formatting bulks as "bulk: a, b, c" lines into reusable buffer
+// that is written by single write(2) call according to flush policy.
+// Everything buffered is written when worker has nothing to do and
+// when the sink is destroyed. Failed write throws std::system_error and the
+// buffer is discarded; worker keeps the error and rethrows it by join.
+class ConsoleSink {
+public:
+    explicit ConsoleSink(const ConsoleOptions& options, int fd = 1);
+    ConsoleSink(const ConsoleSink& other);
+    ~ConsoleSink();
+
+    ConsoleSink& operator= (const ConsoleSink&) = delete;
+
+    void operator() (const Block& block);
+    void flush();
+
+private:
+    bool expired() const;
+
+    const ConsoleOptions options_;
+    const int fd_;
+    std::string buffer_;
+    std::chrono::steady_clock::time_point first_buffered_;
+};
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace griha {
+
+// Counter updated by one thread at once and read by any thread at any time.
+// Load and store are enough for the only writer, so update doesn't lock
+// the cache line like fetch_add does. Counters of different threads have
+// to be kept on different cache lines.
+class Counter {
+public:
+    void add(uint64_t n) {
+        value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    Counter& operator++ () {
+        add(1);
+        return *this;
+    }
+
+    uint64_t get() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_ { 0 };
+};
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "executor.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace griha {
+
+namespace {
+
+// pass of lane grows by c_stride / weight every run
+constexpr uint64_t c_stride = 1u << 20;
+
+} // unnamed namespace
+
+Executor::Executor(size_t nthreads, const std::vector<CpuSet>& placement) {
+    nthreads = std::max<size_t>(nthreads, 1u);
+    metrics_.reset(new ThreadMetrics[nthreads]);
+    threads_.reserve(nthreads);
+    try {
+        for (auto i = 0u; i < nthreads; ++i) {
+            threads_.emplace_back([this, i] { work(metrics_[i]); });
+            if (!placement.empty())
+                pin_thread(threads_.back().native_handle(), placement[i % placement.size()]);
+        }
+    } catch (...) {
+        stop();
+        throw;
+    }
+}
+
+Executor::~Executor() {
+    stop();
+}
+
+void Executor::stop() {
+    {
+        std::lock_guard<std::mutex> l { guard_ };
+        stopping_ = true;
+    }
+    epoch_.fetch_add(1, std::memory_order_release);
+    work_.notify_all();
+
+    for (auto& t : threads_)
+        t.join();
+}
+
+void Executor::add(Lane& lane, const LaneOptions& options) {
+    auto entry = std::make_unique<Entry>();
+    entry->lane = &lane;
+    entry->options = options;
+    entry->options.concurrency = std::max<size_t>(options.concurrency, 1u);
+    entry->options.weight = std::max(options.weight, 1u);
+    for (auto slot = entry->options.concurrency; slot > 0; --slot)
+        entry->free_slots.push_back(slot - 1);
+
+    std::lock_guard<std::mutex> l { guard_ };
+    entry->pass = virtual_time_;
+    entries_.push_back(std::move(entry));
+}
+
+void Executor::remove(Lane& lane) {
+    std::unique_lock<std::mutex> l { guard_ };
+    auto entry = find(lane);
+    if (entry == nullptr)
+        return;
+
+    idle_.wait(l, [entry] { return entry->free_slots.size() == entry->options.concurrency; });
+    entries_.erase(std::find_if(entries_.begin(), entries_.end(),
+        [entry] (auto& e) { return e.get() == entry; }));
+}
+
+void Executor::notify() {
+    epoch_.fetch_add(1, std::memory_order_release);
+    work_.notify_one();
+}
+
+void Executor::drain(Lane& lane) {
+    std::unique_lock<std::mutex> l { guard_ };
+    auto entry = find(lane);
+    if (entry == nullptr)
+        return;
+
+    idle_.wait(l, [entry] {
+        return entry->free_slots.size() == entry->options.concurrency && !entry->lane->ready();
+    });
+}
+
+auto Executor::find(Lane& lane) -> Entry* {
+    for (auto& entry : entries_)
+        if (entry->lane == &lane)
+            return entry.get();
+    return nullptr;
+}
+
+auto Executor::pick() -> Entry* {
+    Entry* best = nullptr;
+    for (auto& entry : entries_) {
+        if (entry->free_slots.empty() || !entry->lane->ready())
+            continue;
+        // lane being idle for long doesn't get threads for all the missed time
+        entry->pass = std::max(entry->pass, virtual_time_);
+        if (best == nullptr
+                || entry->options.priority > best->options.priority
+                || (entry->options.priority == best->options.priority && entry->pass < best->pass))
+            best = entry.get();
+    }
+
+    if (best != nullptr) {
+        virtual_time_ = best->pass;
+        best->pass += c_stride / best->options.weight;
+    }
+    return best;
+}
+
+void Executor::work(ThreadMetrics& metrics) {
+    using clock = std::chrono::steady_clock;
+    const auto elapsed_ns = [] (clock::time_point since) {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - since).count());
+    };
+
+    BULKMT_TRACE_THREAD("executor");
+    std::unique_lock<std::mutex> l { guard_, std::defer_lock };
+    while (true) {
+        // lanes made ready after this point change the epoch
+        const auto epoch = epoch_.load(std::memory_order_acquire);
+
+        {
+            // contention on scheduler lock shows up as long spans
+            BULKMT_TRACE_SPAN("executor", "lock");
+            l.lock();
+        }
+        if (stopping_)
+            return;
+        auto entry = pick();
+        if (entry == nullptr) {
+            l.unlock();
+            BULKMT_TRACE_SPAN("executor", "idle");
+            const auto start = clock::now();
+            work_.wait([this, epoch] { return epoch_.load(std::memory_order_acquire) != epoch; });
+            metrics.idle_ns.add(elapsed_ns(start));
+            continue;
+        }
+        const auto slot = entry->free_slots.back();
+        entry->free_slots.pop_back();
+        l.unlock();
+
+        const auto start = clock::now();
+        entry->lane->run(slot, c_batch_size);
+        metrics.busy_ns.add(elapsed_ns(start));
+
+        l.lock();
+        entry->free_slots.push_back(slot);
+        const auto idle = entry->free_slots.size() == entry->options.concurrency;
+        l.unlock();
+
+        if (idle)
+            idle_.notify_all();
+    }
+}
+
+} // namespace griha
\ No newline at end of file
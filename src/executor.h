@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "affinity.h"
+#include "counter.h"
+#include "wait_point.h"
+
+namespace griha {
+
+// Source of tasks run by executor. Every thread running tasks of the lane
+// holds its own slot in range [0, concurrency), so state of slot isn't
+// shared by threads.
+struct Lane {
+    virtual ~Lane() {}
+    // lane has tasks to run; it's called by threads looking for work
+    virtual bool ready() const = 0;
+    // runs up to max_tasks tasks; returns number of run tasks;
+    // it mustn't throw, exception would terminate the process
+    virtual size_t run(size_t slot, size_t max_tasks) = 0;
+};
+
+struct LaneOptions {
+    size_t concurrency { 1 };   // maximum number of threads running lane at once
+    unsigned weight { 1 };      // share of threads among ready lanes of the same priority
+    int priority { 0 };         // ready lanes of higher priority are run first
+};
+
+// Process-wide pool of threads shared by lanes. A free thread takes the
+// ready lane of the highest priority that has a free slot; lanes of the same
+// priority are taken in proportion to their weights by stride scheduling.
+// The lane is run by batches, so other lanes get threads between them.
+class Executor {
+public:
+    static constexpr size_t c_batch_size = 64; // tasks
+
+    // counters of thread are read while it works
+    struct alignas(c_cache_line_size) ThreadMetrics {
+        Counter busy_ns;    // running lanes
+        Counter idle_ns;    // waiting for ready lane
+    };
+
+public:
+    // thread i is pinned to placement[i % placement.size()] if placement
+    // isn't empty; throws std::system_error if thread can't be pinned
+    explicit Executor(size_t nthreads, const std::vector<CpuSet>& placement = {});
+    // lanes have to be removed before
+    ~Executor();
+
+    Executor(const Executor&) = delete;
+    Executor& operator= (const Executor&) = delete;
+
+    void add(Lane& lane, const LaneOptions& options);
+    // waits until the lane isn't run by any thread
+    void remove(Lane& lane);
+
+    // has to be called when lane becomes ready
+    void notify();
+    // waits until the lane isn't ready and isn't run by any thread
+    void drain(Lane& lane);
+
+    size_t nthreads() const { return threads_.size(); }
+    const ThreadMetrics& thread_metrics(size_t i) const { return metrics_[i]; }
+
+private:
+    struct Entry {
+        Lane* lane;
+        LaneOptions options;
+        std::vector<size_t> free_slots;
+        uint64_t pass { 0 };    // virtual time of the next run
+    };
+
+    void work(ThreadMetrics& metrics);
+    void stop();
+    Entry* pick();
+    Entry* find(Lane& lane);
+
+    std::mutex guard_;
+    std::vector<std::unique_ptr<Entry>> entries_;
+    uint64_t virtual_time_ { 0 };
+    bool stopping_ { false };
+    std::condition_variable idle_;
+
+    // threads without work sleep until the epoch is changed
+    std::atomic<uint64_t> epoch_ { 0 };
+    WaitPoint work_;
+
+    std::unique_ptr<ThreadMetrics[]> metrics_;
+    std::vector<std::thread> threads_;
+};
+
+using ExecutorPtr = std::shared_ptr<Executor>;
+
+} // namespace griha
\ No newline at end of file
@@ -9,6 +9,16 @@ struct Statement;
 using StatementPtr = std::shared_ptr<Statement>;
 using StatementContainer = std::vector<StatementPtr>;
 
+class Block;
+using BlockPtr = std::shared_ptr<const Block>;
+class BlockBuilder;
+
+template <typename Kind>
+class StatementBatch;
+
+class InputChunk;
+using InputChunkPtr = std::shared_ptr<const InputChunk>;
+
 class Reader;
 
 struct ReaderSubscriber;
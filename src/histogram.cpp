@@ -0,0 +1,69 @@
+#include "histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace griha {
+
+namespace {
+
+unsigned log2(uint64_t value) {
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+}
+
+} // unnamed namespace
+
+size_t Histogram::bucket(uint64_t value) {
+    if (value < c_linear)
+        return static_cast<size_t>(value);
+
+    // c_sub_bits bits after the highest one select bucket inside power of two
+    const auto exponent = log2(value);
+    const auto sub = (value >> (exponent - c_sub_bits)) & ((1u << c_sub_bits) - 1);
+    return c_linear + (exponent - c_sub_bits - 1) * (1u << c_sub_bits) + sub;
+}
+
+uint64_t Histogram::upper_bound(size_t bucket) {
+    if (bucket < c_linear)
+        return bucket;
+
+    const auto exponent = (bucket - c_linear) / (1u << c_sub_bits) + c_sub_bits + 1;
+    const auto sub = (bucket - c_linear) % (1u << c_sub_bits);
+    const auto width = uint64_t { 1 } << (exponent - c_sub_bits);
+    return ((1u << c_sub_bits) + sub) * width + (width - 1);
+}
+
+void Histogram::record(uint64_t value) {
+    ++buckets_[bucket(value)];
+    ++count_;
+    max_ = std::max(max_, value);
+}
+
+void Histogram::clear() {
+    buckets_.fill(0);
+    count_ = 0;
+    max_ = 0;
+}
+
+void Histogram::merge(const Histogram& other) {
+    for (size_t i = 0; i < c_nbuckets; ++i)
+        buckets_[i] += other.buckets_[i];
+    count_ += other.count_;
+    max_ = std::max(max_, other.max_);
+}
+
+uint64_t Histogram::percentile(double p) const {
+    if (count_ == 0)
+        return 0;
+
+    const auto rank = std::max<size_t>(1u, static_cast<size_t>(std::ceil(p / 100 * count_)));
+    size_t seen = 0;
+    for (size_t i = 0; i < c_nbuckets; ++i) {
+        seen += buckets_[i];
+        if (seen >= rank)
+            return std::min(upper_bound(i), max_);
+    }
+    return max_;
+}
+
+} // namespace griha
\ No newline at end of file
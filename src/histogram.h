@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace griha {
+
+// Counts values by buckets growing with magnitude of value, so memory
+// doesn't depend on number of values. Values below 16 are counted exactly,
+// greater ones within 1/8 of the value. Percentile reports the upper bound
+// of the bucket the value falls into.
+class Histogram {
+public:
+    void record(uint64_t value);
+    void clear();
+    // adds values recorded by other histogram
+    void merge(const Histogram& other);
+
+    // p is in range [0, 100]; 0 is returned if nothing has been recorded
+    uint64_t percentile(double p) const;
+
+    size_t count() const { return count_; }
+    uint64_t max() const { return max_; }
+
+private:
+    static constexpr unsigned c_sub_bits = 3;
+    static constexpr unsigned c_linear = 2u << c_sub_bits;
+    static constexpr size_t c_nbuckets = c_linear + (64 - c_sub_bits - 1) * (1u << c_sub_bits);
+
+    static size_t bucket(uint64_t value);
+    static uint64_t upper_bound(size_t bucket);
+
+    std::array<size_t, c_nbuckets> buckets_ {};
+    size_t count_ { 0 };
+    uint64_t max_ { 0 };
+};
+
+} // namespace griha
\ No newline at end of file
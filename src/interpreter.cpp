@@ -1,204 +1,377 @@
 #include "interpreter.h"
 
+#include <algorithm>
 #include <string>
 #include <vector>
-#include <list>
-#include <thread>
-#include <mutex>
-#include <condition_variable>
 #include <chrono>
-#include <fstream>
-
-#include <boost/format.hpp>
-
-#include <range/v3/utility/iterator.hpp>
-
+#include <optional>
+
+#include "affinity.h"
+#include "backpressure_queue.h"
+#include "block.h"
+#include "block_queue.h"
+#include "block_sizer.h"
+#include "console_sink.h"
+#include "counter.h"
+#include "executor.h"
+#include "histogram.h"
+#include "metrics_exporter.h"
+#include "output_engine.h"
 #include "reader.h"
 #include "reader_subscriber.h"
-#include "statement.h"
+#include "segment_sink.h"
+#include "server.h"
+#include "trace.h"
+#include "work_stealing_queue.h"
+#include "worker.h"
 
 namespace griha {
 
 namespace {
 
-struct Worker : ReaderSubscriber {
-
-    struct Metrics {
-        size_t nblocks;
-        size_t nstatements;
-    };
-    
-    std::vector<Metrics> thread_metrics;
-    std::vector<std::thread> thread_pool;
-    std::mutex guard;
-    std::condition_variable cv_bulks;
-    std::list<StatementContainer> bulks;
-    bool stopped { false };
-
-    template <typename Job>
-    Worker(size_t nthreads, Job&& job) 
-        : thread_metrics(nthreads, {0, 0}) {
-        thread_pool.reserve(nthreads);
-        for (auto i = 0u; i < nthreads; ++i) {
-            thread_pool.push_back(std::thread {
-                std::ref(*this), 
-                std::forward<Job>(job), std::ref(thread_metrics[i])
-            });
-        }
-    }
-
-    ~Worker() {
-        join();
-    }
-
-    template <typename Job>
-    void operator ()(Job&& job, Metrics& metrics) {
-        auto exit = false;
-        while (!exit) {
-            std::unique_lock<std::mutex> l { guard };
-            cv_bulks.wait(l, [this] {
-                return stopped || !bulks.empty();
-            });
-
-            exit = stopped;
-            std::list<StatementContainer> bulks_local;
-            std::swap(bulks, bulks_local);
-
-            l.unlock();
-
-            for (auto& stms : bulks_local) {
-                job(stms);
-
-                // calculate metrics
-                ++metrics.nblocks;
-                metrics.nstatements += stms.size();
-            }
-        }
-    }
-
+std::unique_ptr<BlockQueue> make_queue(Interpreter::Dispatch dispatch, size_t nthreads, size_t capacity) {
+    if (dispatch == Interpreter::Dispatch::work_stealing && nthreads > 1)
+        return std::make_unique<WorkStealingQueue>(nthreads, capacity);
+    return std::make_unique<RingBlockQueue>(capacity);
+}
 
-    void send(StatementContainer stms) {
-        {
-            std::lock_guard<std::mutex> l { guard };
-            bulks.push_back(std::move(stms));
-        }
-        cv_bulks.notify_one();
+// counts blocks published by the reader, counters are read while it works
+struct alignas(c_cache_line_size) ReaderProgress : ReaderSubscriber {
+    Counter nblocks;
+    Counter nstatements;
+    Counter nbytes;
+    Histogram fill_us;  // from the first statement to publishing, it's read at the end
+
+    void on_block(const BlockPtr& stms) override {
+        ++nblocks;
+        nstatements.add(stms->size());
+        nbytes.add(stms->bytes().size());
+        fill_us.record(to_ns(stms->published() - stms->created()) / 1000u);
     }
 
-    void stop() {
-        {
-            std::lock_guard<std::mutex> l { guard };
-            stopped = true;
-        }
-        cv_bulks.notify_all();
-    }
+    void on_unexpected_eof(const BlockPtr&) override {
 
-    void join() {
-        for (auto& t : thread_pool)
-            if (t.joinable())
-                t.join();
     }
+};
 
-    void on_block(const StatementContainer& stms) override {
-        send(stms);
-    }
-
-    void on_unexpected_eof(const StatementContainer&) override {
-
-    }
+using ReaderProgressPtr = std::shared_ptr<ReaderProgress>;
 
+struct Sinks {
+    ReaderProgressPtr progress;
+    WorkerPtr log_worker;
+    WorkerPtr file_worker;
 };
 
-void log_job(const StatementContainer& stms) {
-    using namespace std;
-    using namespace ranges;
+struct InputMetrics {
+    Reader::Metrics reader;
+    std::optional<Server::Metrics> server;
+};
 
-    struct Logger : Executer {
-        ostream_joiner<std::string> osj { cout, ", " };
-        void execute(const SomeStatement &stm) override {
-            *osj = stm.value();
-        }
-    } logger;
+Reader make_reader(const Interpreter::Options& options, const Sinks& sinks) {
+    Reader reader { options.block_size, options.max_block_age };
+    reader.subscribe(sinks.progress);
+    reader.subscribe(sinks.log_worker);
+    reader.subscribe(sinks.file_worker);
+
+    if (options.adaptive.enabled) {
+        // file worker pays for every bulk, so its load drives block size
+        reader.adapt_block_size(std::make_shared<AdaptiveBlockSizer>(options.adaptive,
+                [file_worker = sinks.file_worker] {
+            return DownstreamLoad {
+                file_worker->bulks.metrics().depth,
+                file_worker->bulks.capacity(),
+                file_worker->busy_ns(),
+                file_worker->slots.size()
+            };
+        }));
+    }
+    return reader;
+}
 
-    cout << "bulk: ";
-    for (auto& stm : stms)
-        stm->execute(logger);
-    endl(cout);
+InputMetrics read(std::istream& input, const Interpreter::Options& options, const Sinks& sinks) {
+    auto reader = make_reader(options, sinks);
+    return { reader.run(input), std::nullopt };
 }
 
-void file_job(const StatementContainer& stms) {
-    using namespace std;
-    
-    struct Printer : Executer {
-        ofstream output;
-        void execute(const SomeStatement &stm) override {
-            output << stm.value() << endl;
-        }
-    };
-    
-    const auto now = chrono::system_clock::now();
-    const auto now_ns = chrono::duration_cast<chrono::nanoseconds>(now.time_since_epoch());
-    const auto filename = ( boost::format { "bulk_%1%_%2%.log"s }
-                                % now_ns.count()
-                                % std::this_thread::get_id() ).str();
+InputMetrics read(int fd, const Interpreter::Options& options, const Sinks& sinks) {
+    auto reader = make_reader(options, sinks);
+    return { reader.run(fd, options.parse_threads), std::nullopt };
+}
 
-    Printer printer;
+InputMetrics read(Server& server, const Interpreter::Options&, const Sinks& sinks) {
+    server.subscribe(sinks.progress);
+    server.subscribe(sinks.log_worker);
+    server.subscribe(sinks.file_worker);
+    return { server.run(), server.server_metrics() };
+}
 
-    printer.output.open(filename);
+uint64_t to_us(uint64_t ns) {
+    return ns / 1000u;
+}
 
-    for (auto& stm : stms)
-        stm->execute(printer);
+void write_json(std::ostream& os, const BackpressureQueue::Metrics& m) {
+    os << "{\"depth\":" << m.depth
+       << ",\"high_water\":" << m.high_water
+       << ",\"dropped\":" << m.ndropped
+       << ",\"spilled\":" << m.nspilled << '}';
+}
 
-    printer.output.flush();
-    printer.output.close();
+void write_json(std::ostream& os, const Worker& worker) {
+    os << "{\"queue\":";
+    write_json(os, worker.bulks.metrics());
+    os << ",\"threads\":[";
+    auto sep = "";
+    for (auto& m : worker.thread_metrics) {
+        os << sep
+           << "{\"blocks\":" << m.nblocks.get()
+           << ",\"statements\":" << m.nstatements.get()
+           << ",\"steals\":" << m.nsteals.get()
+           << ",\"bytes\":" << m.nbytes.get()
+           << ",\"busy_us\":" << to_us(m.busy_ns.get()) << '}';
+        sep = ",";
+    }
+    os << "]}";
 }
 
-} // unnamed namespace
+// one JSON object with counters of running threads
+void write_snapshot(std::ostream& os, std::chrono::steady_clock::time_point start,
+                    const Sinks& sinks, const Executor& executor) {
+    const auto uptime = std::chrono::steady_clock::now() - start;
+    os << "{\"uptime_ms\":" << std::chrono::duration_cast<std::chrono::milliseconds>(uptime).count()
+       << ",\"reader\":{\"blocks\":" << sinks.progress->nblocks.get()
+       << ",\"statements\":" << sinks.progress->nstatements.get()
+       << ",\"bytes\":" << sinks.progress->nbytes.get() << '}'
+       << ",\"log\":";
+    write_json(os, *sinks.log_worker);
+    os << ",\"file\":";
+    write_json(os, *sinks.file_worker);
+    os << ",\"executor\":[";
+    auto sep = "";
+    for (auto i = 0u; i < executor.nthreads(); ++i) {
+        auto& m = executor.thread_metrics(i);
+        os << sep
+           << "{\"busy_us\":" << to_us(m.busy_ns.get())
+           << ",\"idle_us\":" << to_us(m.idle_ns.get()) << '}';
+        sep = ",";
+    }
+    os << "]}";
+}
 
-void Interpreter::run(std::istream& input, size_t block_size, size_t nthreads) {
-    using WorkerPtr = std::shared_ptr<Worker>;
+// CPUs of executor threads, one set per thread
+std::vector<CpuSet> executor_placement(const AffinityOptions& affinity) {
+    std::vector<CpuSet> placement;
+    for (auto cpu : affinity.executor)
+        placement.push_back({ cpu });
+    if (placement.empty() && affinity.numa_node >= 0)
+        placement.push_back(numa_node_cpus(affinity.numa_node));
+    return placement;
+}
 
-    Reader reader { block_size };
+// input is read by the calling thread; parse threads inherit its CPUs and
+// memory policy, so chunks and blocks are allocated on the node of consumers
+void place_reader(const AffinityOptions& affinity) {
+    if (!affinity.reader.empty())
+        pin_current_thread(affinity.reader);
+    else if (affinity.numa_node >= 0)
+        pin_current_thread(numa_node_cpus(affinity.numa_node));
+
+    const auto node = memory_node(affinity);
+    if (node >= 0)
+        prefer_node_memory(node);
+}
 
-    WorkerPtr log_worker = std::make_shared<Worker>(1u, log_job);
-    WorkerPtr file_worker = std::make_shared<Worker>(nthreads, file_job);
+template <typename Input>
+void interpret(Input&& input, const Interpreter::Options& options) {
+    BULKMT_TRACE_THREAD("reader");
+    place_reader(options.affinity);
+    // threads are shared by sinks; by default there are as many threads
+    // as sinks can use at once
+    auto executor = std::make_shared<Executor>(
+        options.executor_threads != 0 ? options.executor_threads : options.nthreads + 1,
+        executor_placement(options.affinity));
+    // console output is ordered, so it's written by one thread at once
+    const LaneOptions log_lane { 1u, options.log_schedule.weight, options.log_schedule.priority };
+    const LaneOptions file_lane { std::max<size_t>(options.nthreads, 1u),
+                                  options.file_schedule.weight, options.file_schedule.priority };
+
+    const auto file_backend = available_backend(options.file_backend);
+    if (file_backend != options.file_backend)
+        std::clog << backend_name(options.file_backend) << " isn't available, "
+                  << backend_name(file_backend) << " is used" << std::endl;
+
+    const auto start = std::chrono::steady_clock::now();
+    auto progress = std::make_shared<ReaderProgress>();
+    WorkerPtr log_worker = std::make_shared<Worker>(executor, log_lane, ConsoleSink { options.console },
+        make_queue(Interpreter::Dispatch::shared_queue, 1u, options.log_queue_capacity),
+        options.overflow, options.spill_dir, "log");
+    auto file_queue = make_queue(options.file_dispatch, file_lane.concurrency, options.file_queue_capacity);
+    WorkerPtr file_worker;
+    if (options.file_layout == Interpreter::FileLayout::segments)
+        file_worker = std::make_shared<Worker>(executor, file_lane, SegmentSink { options.segments },
+            std::move(file_queue), options.overflow, options.spill_dir, "file");
+    else if (file_backend != OutputBackend::stream)
+        file_worker = std::make_shared<Worker>(executor, file_lane,
+            OutputSink { file_backend, options.io_depth, options.io_threads },
+            std::move(file_queue), options.overflow, options.spill_dir, "file");
+    else
+        file_worker = std::make_shared<Worker>(executor, file_lane, file_job,
+            std::move(file_queue), options.overflow, options.spill_dir, "file");
+
+    const Sinks sinks { progress, log_worker, file_worker };
+    std::optional<MetricsExporter> exporter;
+    if (options.metrics.enabled()) {
+        exporter.emplace(options.metrics, [start, &sinks, &executor = *executor] (std::ostream& os) {
+            write_snapshot(os, start, sinks, executor);
+        });
+    }
 
-    reader.subscribe(log_worker);
-    reader.subscribe(file_worker);
-    
-    auto reader_metrics = reader.run(input);
+    const auto input_metrics = read(input, options, sinks);
+    const auto& reader_metrics = input_metrics.reader;
 
     // stop workers
     log_worker->stop();
     file_worker->stop();
-    // wait for completing
-    log_worker->join();
+    // wait for completing; files are completed even if console output fails
+    try {
+        log_worker->join();
+    } catch (...) {
+        file_worker->join();
+        throw;
+    }
     file_worker->join();
+    // final snapshot has all blocks handled
+    exporter.reset();
+
+    const auto print_latency = [] (const char* stage, const Histogram& h) {
+        std::clog
+            << "\t\t" << stage << ", us: p50 - " << h.percentile(50)
+            << "; p99 - " << h.percentile(99)
+            << "; p99.9 - " << h.percentile(99.9)
+            << "; max - " << h.max()
+            << std::endl;
+    };
 
     // print metrics
     std::clog << "Metrics" << std::endl;
+    if (input_metrics.server) {
+        const auto& m = *input_metrics.server;
+        std::clog << "\tServer:" << std::endl;
+        std::clog
+            << "\t\tclients - " << m.naccepted
+            << "; max connected - " << m.max_clients
+            << "; rejected - " << m.nrejected
+            << std::endl;
+    }
     std::clog << "\tReader:" << std::endl;
     std::clog
         << "\t\tlines - " << reader_metrics.nlines
         << "; statements - " << reader_metrics.nstatements
         << "; blocks - " << reader_metrics.nblocks
+        << "; chunks - " << reader_metrics.nchunks
+        << "; allocations - " << reader_metrics.nallocations
         << std::endl;
+    if (options.max_block_age.count() != 0) {
+        const auto& age = reader_metrics.block_age;
+        std::clog
+            << "\t\tblock age, us: p50 - " << age.p50.count()
+            << "; p90 - " << age.p90.count()
+            << "; p99 - " << age.p99.count()
+            << "; max - " << age.max.count()
+            << "; expired blocks - " << reader_metrics.nexpired
+            << std::endl;
+    }
+    if (!reader_metrics.block_sizes.empty()) {
+        std::clog << "\t\tblock sizes:";
+        auto sep = " ";
+        for (auto& [size, nblocks] : reader_metrics.block_sizes) {
+            std::clog << sep << size << " - " << nblocks << " blocks";
+            sep = "; ";
+        }
+        std::clog << std::endl;
+    }
+    print_latency("fill", progress->fill_us);
     
+    const auto print_queue = [] (const BackpressureQueue::Metrics& m) {
+        std::clog
+            << "\t\tqueue: depth - " << m.depth
+            << "; high-water mark - " << m.high_water
+            << "; dropped - " << m.ndropped
+            << "; spilled - " << m.nspilled
+            << std::endl;
+    };
+
+    const auto print_latencies = [&print_latency] (const Worker& worker) {
+        print_latency("queue wait", worker.latency(&Worker::Metrics::queue_wait_us));
+        print_latency("service", worker.latency(&Worker::Metrics::service_us));
+        print_latency("end to end", worker.latency(&Worker::Metrics::end_to_end_us));
+    };
+
     std::clog << "\tLog:" << std::endl;
+    print_queue(log_worker->bulks.metrics());
     std::clog
-        << "\t\tblocks - " << log_worker->thread_metrics[0].nblocks
-        << "; statements - " << log_worker->thread_metrics[0].nstatements
+        << "\t\tblocks - " << log_worker->thread_metrics[0].nblocks.get()
+        << "; statements - " << log_worker->thread_metrics[0].nstatements.get()
+        << "; bytes - " << log_worker->thread_metrics[0].nbytes.get()
+        << "; busy, us - " << to_us(log_worker->thread_metrics[0].busy_ns.get())
         << std::endl;
+    print_latencies(*log_worker);
 
     std::clog << "\tFiles:" << std::endl;
+    if (options.file_layout == Interpreter::FileLayout::bulk_per_file)
+        std::clog << "\t\tbackend - " << backend_name(file_backend) << std::endl;
+    print_queue(file_worker->bulks.metrics());
+    print_latencies(*file_worker);
     for (auto i = 0u; i < file_worker->thread_metrics.size(); ++i) {
         auto &m = file_worker->thread_metrics[i];
         std::clog
             << "\t#" << i
-            << "\tblocks - " << m.nblocks
-            << "; statements - " << m.nstatements
+            << "\tblocks - " << m.nblocks.get()
+            << "; statements - " << m.nstatements.get()
+            << "; steals - " << m.nsteals.get()
+            << "; bytes - " << m.nbytes.get()
+            << "; busy, us - " << to_us(m.busy_ns.get())
             << std::endl;
     }
+
+    std::clog << "\tExecutor:" << std::endl;
+    for (auto i = 0u; i < executor->nthreads(); ++i) {
+        auto& m = executor->thread_metrics(i);
+        std::clog
+            << "\t#" << i
+            << "\tbusy, us - " << to_us(m.busy_ns.get())
+            << "; idle, us - " << to_us(m.idle_ns.get())
+            << std::endl;
+    }
+}
+
+} // unnamed namespace
+
+void Interpreter::run(std::istream& input, size_t block_size, size_t nthreads) {
+    Options options;
+    options.block_size = block_size;
+    options.nthreads = nthreads;
+    interpret(input, options);
+}
+
+void Interpreter::run(int fd, size_t block_size, size_t nthreads) {
+    Options options;
+    options.block_size = block_size;
+    options.nthreads = nthreads;
+    interpret(fd, options);
+}
+
+void Interpreter::run(std::istream& input, const Options& options) {
+    interpret(input, options);
+}
+
+void Interpreter::run(int fd, const Options& options) {
+    interpret(fd, options);
+}
+
+void Interpreter::serve(const ServerOptions& server_options, const Options& options) {
+    // server fails before workers are started if address can't be listened
+    Server server { server_options, options.block_size, options.max_block_age };
+    interpret(server, options);
 }
 
 } // namespace griha
\ No newline at end of file
@@ -1,14 +1,68 @@
 #pragma once
 
+#include <chrono>
 #include <iostream>
+#include <string>
 
+#include "affinity.h"
+#include "backpressure_queue.h"
+#include "block_sizer.h"
+#include "console_sink.h"
 #include "forward.h"
+#include "metrics_exporter.h"
+#include "mpmc_queue.h"
+#include "output_engine.h"
 #include "reader.h"
+#include "segment_sink.h"
+#include "server.h"
 
 namespace griha {
 
 class Interpreter {
 
+public:
+    // how blocks are dispatched among threads of file worker
+    enum class Dispatch {
+        shared_queue,   // all threads take blocks from one queue
+        work_stealing   // each thread owns a queue, idle threads steal blocks
+    };
+
+    // how file worker stores blocks
+    enum class FileLayout {
+        bulk_per_file,  // every block is written into its own file
+        segments        // blocks are appended to rolling segment files of thread
+    };
+
+    // share of executor threads given to sink
+    struct Schedule {
+        unsigned weight { 1 };
+        int priority { 0 };
+    };
+
+    struct Options {
+        size_t block_size;
+        size_t nthreads { 2 };
+        Dispatch file_dispatch { Dispatch::shared_queue };
+        size_t log_queue_capacity { c_default_queue_capacity };
+        size_t file_queue_capacity { c_default_queue_capacity };
+        Overflow overflow { Overflow::block };
+        std::string spill_dir { "." };
+        FileLayout file_layout { FileLayout::bulk_per_file };
+        SegmentOptions segments;
+        OutputBackend file_backend { OutputBackend::stream };
+        size_t io_depth { c_default_io_depth };   // files in flight of all file threads
+        size_t io_threads { c_default_io_threads }; // helper threads of pool backend shared by file threads
+        ConsoleOptions console;
+        size_t parse_threads { 1 };   // regular files are parsed in parallel if greater than 1
+        std::chrono::milliseconds max_block_age { 0 };  // zero - dynamic block waits for block size
+        AdaptiveOptions adaptive;   // block size is the initial one in adaptive mode
+        size_t executor_threads { 0 };  // zero - one per file thread and one for console
+        Schedule log_schedule;
+        Schedule file_schedule;
+        AffinityOptions affinity;
+        ExportOptions metrics;      // counters are exported while input is read
+    };
+
 public:
     constexpr Interpreter() = default;
 
@@ -16,6 +70,15 @@ public:
     Interpreter& operator= (const Interpreter&) = delete;
 
     void run(std::istream& input, size_t block_size, size_t nthreads);
+    void run(int fd, size_t block_size, size_t nthreads);
+
+    // calling thread reads input, it's pinned if affinity options tell so;
+    // throws std::system_error if threads can't be pinned
+    void run(std::istream& input, const Options& options);
+    void run(int fd, const Options& options);
+    // serves clients of socket until SIGINT or SIGTERM if server options
+    // tell so; adaptive block size isn't applied
+    void serve(const ServerOptions& server_options, const Options& options);
 };
 
 } // namespace griha
\ No newline at end of file
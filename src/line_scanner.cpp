@@ -0,0 +1,149 @@
+#include "line_scanner.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BULKMT_X86 1
+#endif
+
+namespace griha {
+
+namespace {
+
+// Window being scanned: every found new line symbol closes current line
+struct Window {
+    const char* from;
+    const char* line_begin;
+    LineSpan* spans;
+    size_t nspans { 0 };
+
+    void emit(const char* nl) {
+        const std::string_view line { line_begin, static_cast<size_t>(nl - line_begin) };
+        const auto kind = static_cast<uint32_t>(classify_line(line));
+        spans[nspans++].value = static_cast<uint32_t>(nl - from) << 2 | kind;
+        line_begin = nl + 1;
+    }
+
+    // every set bit of mask is new line symbol at the offset from p
+    void emit(const char* p, uint32_t mask) {
+        while (mask != 0) {
+            emit(p + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    void emit_tail(const char* p, const char* end) {
+        for (; p != end; ++p)
+            if (*p == '\n')
+                emit(p);
+    }
+};
+
+// fallback of processors without SSE2/AVX2: memchr of libc is the search
+// the previous path used per line, so it isn't slower than that path
+size_t scan_scalar(Window w, const char* end) {
+    auto p = w.from;
+    while (p != end) {
+        auto nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (nl == nullptr)
+            break;
+        w.emit(nl);
+        p = nl + 1;
+    }
+    return w.nspans;
+}
+
+#ifdef BULKMT_X86
+
+__attribute__((target("sse2")))
+size_t scan_sse2(Window w, const char* end) {
+    const auto nl = _mm_set1_epi8('\n');
+    auto p = w.from;
+    for (; end - p >= 16; p += 16) {
+        const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        w.emit(p, static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, nl))));
+    }
+    w.emit_tail(p, end);
+    return w.nspans;
+}
+
+__attribute__((target("avx2")))
+size_t scan_avx2(Window w, const char* end) {
+    const auto nl = _mm256_set1_epi8('\n');
+    auto p = w.from;
+    for (; end - p >= 32; p += 32) {
+        const auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        w.emit(p, static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, nl))));
+    }
+    w.emit_tail(p, end);
+    return w.nspans;
+}
+
+#endif // BULKMT_X86
+
+} // unnamed namespace
+
+bool is_supported(ScanIsa isa) {
+    switch (isa) {
+    case ScanIsa::scalar:
+        return true;
+#ifdef BULKMT_X86
+    case ScanIsa::sse2:
+        return __builtin_cpu_supports("sse2");
+    case ScanIsa::avx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+ScanIsa best_scan_isa() {
+    static const auto isa = is_supported(ScanIsa::avx2) ? ScanIsa::avx2
+                          : is_supported(ScanIsa::sse2) ? ScanIsa::sse2
+                          : ScanIsa::scalar;
+    return isa;
+}
+
+size_t scan_lines(ScanIsa isa, const char* begin, const char* from, const char* end, LineSpan* spans) {
+    const Window window { from, begin, spans };
+    switch (isa) {
+#ifdef BULKMT_X86
+    case ScanIsa::avx2:
+        return scan_avx2(window, end);
+    case ScanIsa::sse2:
+        return scan_sse2(window, end);
+#endif
+    default:
+        return scan_scalar(window, end);
+    }
+}
+
+bool RangeLines::scan() {
+    for (auto from = pos_; from != end_; ) {
+        const auto window_end = static_cast<size_t>(end_ - from) > c_scan_window ? from + c_scan_window : end_;
+        nspans_ = scan_lines(isa_, pos_, from, window_end, spans_.data());
+        next_ = 0;
+        if (nspans_ != 0) {
+            window_ = from;
+            line_begin_ = pos_;
+            pos_ = from + spans_[nspans_ - 1].end() + 1;
+            return true;
+        }
+        from = window_end;
+    }
+    return false;
+}
+
+bool RangeLines::last_line(std::string_view& line, LineKind& kind) {
+    if (pos_ == end_)
+        return false;
+    // the last line isn't terminated by new line symbol
+    line = std::string_view { pos_, static_cast<size_t>(end_ - pos_) };
+    kind = classify_line(line);
+    pos_ = end_;
+    return true;
+}
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace griha {
+
+enum class LineKind : uint8_t {
+    statement,
+    block_begin,    // line consists of "{" only
+    block_end       // line consists of "}" only
+};
+
+// Line found by scanner: offset of its new line symbol from the beginning
+// of scanned window and kind of the line packed into 32 bits
+struct LineSpan {
+    uint32_t value;
+
+    size_t end() const { return value >> 2; }
+    LineKind kind() const { return static_cast<LineKind>(value & 3u); }
+};
+
+// offset of new line symbol has to fit into span
+constexpr size_t c_max_scan_window = 1u << 30;
+// number of bytes scanned at once by readers
+constexpr size_t c_scan_window = 16u << 10;
+
+// Instruction set used for searching of new line symbols
+enum class ScanIsa {
+    scalar,
+    sse2,
+    avx2
+};
+
+// the best instruction set supported by the processor
+ScanIsa best_scan_isa();
+bool is_supported(ScanIsa isa);
+
+inline LineKind classify_line(std::string_view line) {
+    if (line.size() == 1) {
+        if (line[0] == '{')
+            return LineKind::block_begin;
+        if (line[0] == '}')
+            return LineKind::block_end;
+    }
+    return LineKind::statement;
+}
+
+// Finds all new line symbols in window [from, end) and stores spans of
+// the lines they terminate; spans has to have room for (end - from) elements.
+// The first line begins at begin, bytes in [begin, from) are known to have no
+// new line symbols; every next line begins after the previous new line symbol.
+// Returns number of found lines.
+size_t scan_lines(ScanIsa isa, const char* begin, const char* from, const char* end, LineSpan* spans);
+
+// Lines of memory range found by scanner window by window.
+// The last line of the range may be not terminated by new line symbol.
+class RangeLines {
+public:
+    RangeLines(const char* begin = nullptr, const char* end = nullptr)
+        : pos_(begin)
+        , end_(end)
+        , isa_(best_scan_isa())
+        , spans_(c_scan_window) {}
+
+    // starts lines of another range keeping the buffer of spans
+    void reset(const char* begin, const char* end) {
+        pos_ = begin;
+        end_ = end;
+        nspans_ = next_ = 0;
+    }
+
+    // beginning of the next line
+    const char* position() const { return next_ == nspans_ ? pos_ : line_begin_; }
+
+    bool next_line(std::string_view& line, LineKind& kind) {
+        if (next_ == nspans_ && !scan())
+            return last_line(line, kind);
+
+        const auto span = spans_[next_++];
+        const auto nl = window_ + span.end();
+        line = std::string_view { line_begin_, static_cast<size_t>(nl - line_begin_) };
+        kind = span.kind();
+        line_begin_ = nl + 1;
+        return true;
+    }
+
+private:
+    bool scan();
+    bool last_line(std::string_view& line, LineKind& kind);
+
+    const char* pos_;
+    const char* end_;
+    ScanIsa isa_;
+    std::vector<LineSpan> spans_;
+    size_t nspans_ { 0 };
+    size_t next_ { 0 };
+    const char* window_ { nullptr };
+    const char* line_begin_ { nullptr };
+};
+
+} // namespace griha
\ No newline at end of file
@@ -1,22 +1,219 @@
+#include <algorithm>
+#include <csignal>
+#include <exception>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 
+#include <unistd.h>
+
+#include <boost/program_options.hpp>
+
 #include "interpreter.h"
+#include "trace.h"
 
 using namespace std;
 using namespace griha;
 
+namespace po = boost::program_options;
+
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        cerr << "Usage: bulk <block_size> [<nthreads>]" << endl;
+    Interpreter::Options options;
+    string dispatch;
+    string overflow;
+    string file_layout;
+    string file_backend;
+    string log_flush;
+    size_t log_flush_interval = options.console.flush_interval.count();
+    size_t segment_age = options.segments.max_age.count();
+    size_t max_block_age = options.max_block_age.count();
+    size_t metrics_period = options.metrics.period.count();
+    string reader_cpus;
+    string executor_cpus;
+    string trace_file;
+    ServerOptions server;
+
+    po::options_description visible { "Options" };
+    visible.add_options()
+        ("help,h", "print this message")
+        ("dispatch", po::value(&dispatch)->default_value("queue"),
+            "dispatch of blocks among file threads: queue | stealing")
+        ("log-queue-capacity", po::value(&options.log_queue_capacity)->default_value(options.log_queue_capacity),
+            "maximum number of blocks queued for console output")
+        ("file-queue-capacity", po::value(&options.file_queue_capacity)->default_value(options.file_queue_capacity),
+            "maximum number of blocks queued for file output")
+        ("overflow", po::value(&overflow)->default_value("block"),
+            "action on full queue: block | drop | spill")
+        ("spill-dir", po::value(&options.spill_dir)->default_value(options.spill_dir),
+            "directory of overflow files")
+        ("file-layout", po::value(&file_layout)->default_value("bulk"),
+            "layout of output files: bulk - file per block | segment - rolling segments of thread")
+        ("segment-dir", po::value(&options.segments.dir)->default_value(options.segments.dir),
+            "directory of segment files")
+        ("segment-size", po::value(&options.segments.max_size)->default_value(options.segments.max_size),
+            "size of segment in bytes that triggers rotation")
+        ("segment-age", po::value(&segment_age)->default_value(segment_age),
+            "age of segment in seconds that triggers rotation")
+        ("file-backend", po::value(&file_backend)->default_value("stream"),
+            "writing of bulk files: stream | uring - io_uring, thread pool if unavailable | pool - thread pool")
+        ("io-depth", po::value(&options.io_depth)->default_value(options.io_depth),
+            "maximum number of files being written by file threads asynchronously")
+        ("io-threads", po::value(&options.io_threads)->default_value(options.io_threads),
+            "helper threads writing files of pool backend, shared by file threads")
+        ("log-flush", po::value(&log_flush)->default_value("bulk"),
+            "when console output is written: bulk - every bulk | size - by buffer size | time - by bulk age")
+        ("log-flush-size", po::value(&options.console.flush_size)->default_value(options.console.flush_size),
+            "size of console buffer in bytes that triggers writing")
+        ("log-flush-interval", po::value(&log_flush_interval)->default_value(log_flush_interval),
+            "age of buffered bulk in milliseconds that triggers writing")
+        ("parse-threads", po::value(&options.parse_threads)->default_value(options.parse_threads),
+            "number of threads parsing input if it's a regular file")
+        ("max-block-age", po::value(&max_block_age)->default_value(max_block_age),
+            "age of dynamic block in milliseconds after which it's flushed incomplete; 0 - never")
+        ("adaptive", po::bool_switch(&options.adaptive.enabled),
+            "tune size of dynamic blocks by load of file threads")
+        ("min-block-size", po::value(&options.adaptive.min_size)->default_value(options.adaptive.min_size),
+            "minimum size of dynamic block in adaptive mode")
+        ("max-block-size", po::value(&options.adaptive.max_size)->default_value(options.adaptive.max_size),
+            "maximum size of dynamic block in adaptive mode")
+        ("executor-threads", po::value(&options.executor_threads)->default_value(options.executor_threads),
+            "number of threads shared by console and file output; 0 - nthreads + 1")
+        ("log-weight", po::value(&options.log_schedule.weight)->default_value(options.log_schedule.weight),
+            "share of executor threads given to console output")
+        ("log-priority", po::value(&options.log_schedule.priority)->default_value(options.log_schedule.priority),
+            "console output is served first if its priority is higher")
+        ("file-weight", po::value(&options.file_schedule.weight)->default_value(options.file_schedule.weight),
+            "share of executor threads given to file output")
+        ("file-priority", po::value(&options.file_schedule.priority)->default_value(options.file_schedule.priority),
+            "file output is served first if its priority is higher")
+        ("reader-cpus", po::value(&reader_cpus),
+            "CPUs of reader thread, e.g. 0-3,8")
+        ("executor-cpus", po::value(&executor_cpus),
+            "CPUs of executor threads, each thread is pinned to one of them")
+        ("numa-node", po::value(&options.affinity.numa_node)->default_value(options.affinity.numa_node),
+            "NUMA node of executor threads and memory of blocks, reader is pinned to it unless it has CPUs; -1 - node of executor CPUs")
+        ("metrics-file", po::value(&options.metrics.file),
+            "append JSON line with live counters of threads to the file every period")
+        ("metrics-socket", po::value(&options.metrics.socket),
+            "serve JSON line with live counters of threads on unix:<path> or <host>:<port>")
+        ("metrics-period", po::value(&metrics_period)->default_value(metrics_period),
+            "period of writing metrics file in milliseconds")
+        ("trace", po::value(&trace_file),
+            "write Chrome trace JSON of reader, worker and executor spans to the file "
+            "on exit and on SIGUSR1; needs build with BULKMT_TRACE")
+        ("listen", po::value(&server.address),
+            "serve clients of socket unix:<path> or <host>:<port> instead of reading standard input")
+        ("max-line", po::value(&server.max_line)->default_value(server.max_line),
+            "maximum length of line of client in bytes, longer line closes the connection");
+
+    po::options_description hidden;
+    hidden.add_options()
+        ("block-size", po::value(&options.block_size)->required())
+        ("nthreads", po::value(&options.nthreads)->default_value(options.nthreads));
+
+    po::options_description all;
+    all.add(visible).add(hidden);
+
+    po::positional_options_description positional;
+    positional.add("block-size", 1).add("nthreads", 1);
+
+    const auto usage = [&visible] (ostream& os) {
+        os << "Usage: bulk <block_size> [<nthreads>] [options]" << endl << visible;
+    };
+
+    try {
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv).options(all).positional(positional).run(), vm);
+        if (vm.count("help")) {
+            usage(cout);
+            return 0;
+        }
+        po::notify(vm);
+
+        if (dispatch == "queue")
+            options.file_dispatch = Interpreter::Dispatch::shared_queue;
+        else if (dispatch == "stealing")
+            options.file_dispatch = Interpreter::Dispatch::work_stealing;
+        else
+            throw po::invalid_option_value(dispatch);
+
+        if (overflow == "block")
+            options.overflow = Overflow::block;
+        else if (overflow == "drop")
+            options.overflow = Overflow::drop_oldest;
+        else if (overflow == "spill")
+            options.overflow = Overflow::spill;
+        else
+            throw po::invalid_option_value(overflow);
+
+        if (file_layout == "bulk")
+            options.file_layout = Interpreter::FileLayout::bulk_per_file;
+        else if (file_layout == "segment")
+            options.file_layout = Interpreter::FileLayout::segments;
+        else
+            throw po::invalid_option_value(file_layout);
+        options.segments.max_age = chrono::seconds { segment_age };
+
+        if (file_backend == "stream")
+            options.file_backend = OutputBackend::stream;
+        else if (file_backend == "uring")
+            options.file_backend = OutputBackend::uring;
+        else if (file_backend == "pool")
+            options.file_backend = OutputBackend::pool;
+        else
+            throw po::invalid_option_value(file_backend);
+
+        if (log_flush == "bulk")
+            options.console.flush = ConsoleFlush::per_bulk;
+        else if (log_flush == "size")
+            options.console.flush = ConsoleFlush::by_size;
+        else if (log_flush == "time")
+            options.console.flush = ConsoleFlush::by_time;
+        else
+            throw po::invalid_option_value(log_flush);
+        options.console.flush_interval = chrono::milliseconds { log_flush_interval };
+        options.max_block_age = chrono::milliseconds { max_block_age };
+        options.metrics.period = chrono::milliseconds { max<size_t>(metrics_period, 1u) };
+
+        const auto cpus = [] (const string& list) {
+            try {
+                return list.empty() ? CpuSet {} : parse_cpu_list(list);
+            } catch (const invalid_argument&) {
+                throw po::invalid_option_value(list);
+            }
+        };
+        options.affinity.reader = cpus(reader_cpus);
+        options.affinity.executor = cpus(executor_cpus);
+        try {
+            check_affinity(options.affinity);
+        } catch (const invalid_argument& e) {
+            throw po::error { e.what() };
+        }
+    } catch (const po::error& e) {
+        cerr << e.what() << endl;
+        usage(cerr);
         return -1;
     }
 
     Interpreter interpreter;
-    interpreter.run(
-        cin,
-        stoul(argv[1]), // size of block
-        argc == 2 ? 2u : stoul(argv[2]) // number of threads
-    );
+    try {
+        if (!trace_file.empty()) {
+            if (!trace::c_compiled)
+                cerr << "tracing spans aren't compiled in, rebuild with BULKMT_TRACE" << endl;
+            trace::start(trace_file, SIGUSR1);
+        }
+
+        if (server.address.empty()) {
+            interpreter.run(STDIN_FILENO, options);
+        } else {
+            server.stop_on_signals = true;
+            interpreter.serve(server, options);
+        }
+        trace::stop();
+    } catch (const exception& e) {
+        trace::stop();
+        cerr << e.what() << endl;
+        return -1;
+    }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "metrics_exporter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <sstream>
+#include <system_error>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "socket_address.h"
+
+namespace griha {
+
+namespace {
+
+[[noreturn]] void throw_error(int error, const std::string& what) {
+    throw std::system_error { error, std::generic_category(), what };
+}
+
+void write_all(int fd, const std::string& data, bool socket) {
+    for (size_t written = 0; written < data.size(); ) {
+        const auto rest = data.data() + written;
+        const auto size = data.size() - written;
+        // peer of socket may have gone, it mustn't raise SIGPIPE; slow peer
+        // mustn't delay exporting
+        const auto n = socket ? send(fd, rest, size, MSG_NOSIGNAL | MSG_DONTWAIT) : write(fd, rest, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return; // metrics aren't worth an error, client that can't keep up is dropped
+        written += static_cast<size_t>(n);
+    }
+}
+
+} // unnamed namespace
+
+MetricsExporter::MetricsExporter(const ExportOptions& options, Snapshot snapshot)
+    : options_(options)
+    , snapshot_(std::move(snapshot)) {
+    try {
+        if (!options_.file.empty()) {
+            file_fd_ = open(options_.file.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if (file_fd_ < 0)
+                throw_error(errno, "can't open metrics file " + options_.file);
+        }
+        if (!options_.socket.empty()) {
+            const auto address = parse_socket_address(options_.socket);
+            listen_fd_ = listen_socket(address, 16);
+            unix_path_ = address.unix_path;
+            // client may go away between poll and accept
+            if (fcntl(listen_fd_, F_SETFL, fcntl(listen_fd_, F_GETFL) | O_NONBLOCK) != 0)
+                throw_error(errno, "can't make metrics socket non-blocking");
+        }
+        stop_fd_ = eventfd(0, EFD_CLOEXEC);
+        if (stop_fd_ < 0)
+            throw_error(errno, "can't create eventfd");
+    } catch (...) {
+        close_fds();
+        throw;
+    }
+    thread_ = std::thread { [this] { run(); } };
+}
+
+MetricsExporter::~MetricsExporter() {
+    const uint64_t one = 1;
+    if (write(stop_fd_, &one, sizeof(one)) < 0) {
+        // eventfd counter can't overflow by one write
+    }
+    thread_.join();
+
+    if (file_fd_ >= 0)
+        write_file();
+    close_fds();
+}
+
+void MetricsExporter::close_fds() {
+    if (file_fd_ >= 0)
+        close(file_fd_);
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        if (!unix_path_.empty())
+            unlink(unix_path_.c_str());
+    }
+    if (stop_fd_ >= 0)
+        close(stop_fd_);
+}
+
+void MetricsExporter::run() {
+    using namespace std::chrono;
+
+    auto deadline = steady_clock::now() + options_.period;
+    while (true) {
+        pollfd fds[2] = { { stop_fd_, POLLIN, 0 }, { listen_fd_, POLLIN, 0 } };
+        const auto timeout = file_fd_ < 0 ? -1
+            : static_cast<int>(std::max<long long>(
+                duration_cast<milliseconds>(deadline - steady_clock::now()).count(), 0));
+        const auto n = poll(fds, listen_fd_ < 0 ? 1 : 2, timeout);
+        if (n < 0 && errno != EINTR)
+            return;
+
+        if (fds[0].revents != 0)
+            return;
+        if (listen_fd_ >= 0 && (fds[1].revents & POLLIN) != 0)
+            serve_clients();
+
+        if (file_fd_ >= 0 && steady_clock::now() >= deadline) {
+            write_file();
+            deadline += options_.period;
+            // don't catch up periods missed by the sleeping process
+            deadline = std::max(deadline, steady_clock::now());
+        }
+    }
+}
+
+void MetricsExporter::write_file() {
+    std::ostringstream os;
+    snapshot_(os);
+    os << '\n';
+    write_all(file_fd_, os.str(), false);
+}
+
+// every client gets snapshot it can take at once, nothing waits for it
+void MetricsExporter::serve_clients() {
+    while (true) {
+        const auto fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0 && errno == EINTR)
+            continue;
+        if (fd < 0)
+            return;
+        std::ostringstream os;
+        snapshot_(os);
+        os << '\n';
+        write_all(fd, os.str(), true);
+        close(fd);
+    }
+}
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <thread>
+
+namespace griha {
+
+struct ExportOptions {
+    std::string file;       // snapshot is appended every period; empty - no file
+    std::string socket;     // unix:<path> or <host>:<port>; every client gets current snapshot,
+                            // client that can't take it at once is dropped
+    std::chrono::milliseconds period { 1000 };
+
+    bool enabled() const { return !file.empty() || !socket.empty(); }
+};
+
+// Exports metrics of running process. Snapshot is one line written by the
+// exporter thread, so it can read only counters which may be read while
+// other threads update them.
+class MetricsExporter {
+public:
+    using Snapshot = std::function<void (std::ostream&)>;
+
+public:
+    // throws std::system_error or std::invalid_argument if file or socket
+    // can't be opened
+    MetricsExporter(const ExportOptions& options, Snapshot snapshot);
+    // final snapshot is appended to the file
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator= (const MetricsExporter&) = delete;
+
+private:
+    void run();
+    void write_file();
+    void serve_clients();
+    void close_fds();
+
+    ExportOptions options_;
+    Snapshot snapshot_;
+    int file_fd_ { -1 };
+    int listen_fd_ { -1 };
+    std::string unix_path_;
+    int stop_fd_ { -1 };
+    std::thread thread_;
+};
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "wait_point.h"
+
+namespace griha {
+
+constexpr size_t c_default_queue_capacity = 1024;
+
+// Bounded lock-free multi-producer multi-consumer queue (D. Vyukov's ring
+// buffer). Every cell carries a sequence number that tells whether the cell
+// is ready for writing or for reading at the given position.
+// Blocking push/pop spin for a while and then park on the wait point.
+template <typename T>
+class MpmcQueue {
+public:
+    explicit MpmcQueue(size_t capacity = c_default_queue_capacity) {
+        // capacity is rounded up to power of two
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+
+        mask_ = size - 1;
+        cells_.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i)
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    ~MpmcQueue() {
+        T value;
+        while (try_pop(value)) {
+            // destroy remaining elements
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator= (const MpmcQueue&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // approximate number of elements
+    size_t size() const {
+        const auto tail = tail_.pos.load(std::memory_order_relaxed);
+        const auto head = head_.pos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+    bool try_push(T& value) {
+        auto pos = tail_.pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            const auto seq = cell->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (tail_.pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false; // queue is full
+            } else {
+                pos = tail_.pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        new (&cell->storage) T(std::move(value));
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        not_empty_.notify_one();
+        return true;
+    }
+
+    bool try_pop(T& value) {
+        auto pos = head_.pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            const auto seq = cell->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (head_.pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false; // queue is empty
+            } else {
+                pos = head_.pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        auto element = reinterpret_cast<T*>(&cell->storage);
+        value = std::move(*element);
+        element->~T();
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        not_full_.notify_one();
+        return true;
+    }
+
+    // waits while queue is full
+    void push(T value) {
+        while (!try_push(value))
+            not_full_.wait([this] { return size() < capacity() || closed(); });
+    }
+
+    // waits for an element; returns false if queue is closed and empty
+    bool pop(T& value) {
+        while (!try_pop(value)) {
+            if (closed()) {
+                // elements pushed before closing have to be handled
+                if (try_pop(value))
+                    return true;
+                return false;
+            }
+            not_empty_.wait([this] { return !empty() || closed(); });
+        }
+        return true;
+    }
+
+    // wakes up all waiters, pop returns false when queue becomes empty
+    void close() {
+        closed_.store(true, std::memory_order_release);
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    // producers and consumers update positions on different cache lines
+    struct alignas(c_cache_line_size) Position {
+        std::atomic<size_t> pos { 0 };
+    };
+
+    Position tail_;
+    Position head_;
+    alignas(c_cache_line_size) std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    std::atomic<bool> closed_ { false };
+
+    WaitPoint not_empty_;
+    WaitPoint not_full_;
+};
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,578 @@
+#include "output_engine.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define BULKMT_HAS_URING 1
+#endif
+
+#include <boost/format.hpp>
+
+#include "block.h"
+#include "mpmc_queue.h"
+#include "statement.h"
+#include "wait_point.h"
+
+namespace griha {
+
+namespace {
+
+constexpr int c_open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+constexpr mode_t c_open_mode = 0644;
+
+[[noreturn]] void throw_error(int error, const std::string& what) {
+    throw std::system_error { error, std::generic_category(), what };
+}
+
+#ifdef BULKMT_HAS_URING
+
+// Every bulk is written by the chain of linked requests
+// open -> write -> close that uses fixed file slot of the ring,
+// so the whole chain is submitted at once without waiting for descriptor.
+// Chains of many bulks are submitted by one system call.
+class UringEngine : public OutputEngine {
+public:
+    explicit UringEngine(size_t depth) : slots_(depth) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(depth * c_chain_size), &params));
+        if (fd_ < 0)
+            throw_error(errno, "can't setup io_uring");
+
+        try {
+            map_rings(params);
+            check_support();
+            register_slots();
+            check_direct_open();
+        } catch (...) {
+            unmap_rings();
+            ::close(fd_);
+            throw;
+        }
+
+        free_slots_.reserve(depth);
+        for (auto i = depth; i > 0; --i)
+            free_slots_.push_back(static_cast<unsigned>(i - 1));
+    }
+
+    ~UringEngine() override {
+        try {
+            drain();
+        } catch (const std::system_error&) {
+            // owner calls drain to get errors, this one follows a reported error
+        }
+        unmap_rings();
+        ::close(fd_);
+    }
+
+    void write(std::string filename, BlockPtr block) override {
+        rethrow();
+        while (free_slots_.empty())
+            enter(1);
+
+        const auto slot = free_slots_.back();
+        free_slots_.pop_back();
+
+        auto& request = slots_[slot];
+        request.filename = std::move(filename);
+        request.block = std::move(block);
+        request.ncompletions = 0;
+        request.error = 0;
+
+        const auto bytes = request.block->bytes();
+
+        auto sqe = next_sqe();
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->flags = IOSQE_IO_LINK;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<uintptr_t>(request.filename.c_str());
+        sqe->len = c_open_mode;
+        // direct descriptor doesn't belong to process, so it can't be close-on-exec
+        sqe->open_flags = c_open_flags & ~O_CLOEXEC;
+        sqe->file_index = slot + 1;
+        sqe->user_data = slot;
+
+        sqe = next_sqe();
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->flags = IOSQE_IO_LINK | IOSQE_FIXED_FILE;
+        sqe->fd = static_cast<int>(slot);
+        sqe->addr = reinterpret_cast<uintptr_t>(bytes.data());
+        sqe->len = static_cast<unsigned>(bytes.size());
+        sqe->off = 0;
+        sqe->user_data = slot;
+
+        sqe = next_sqe();
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->file_index = slot + 1;
+        sqe->user_data = slot;
+
+        // write of shorter length breaks the chain as well
+        request.expected = static_cast<int>(bytes.size());
+        ++ninflight_;
+    }
+
+    void submit() override {
+        if (npending_ != 0)
+            enter(0);
+        reap();
+        rethrow();
+    }
+
+    void drain() override {
+        // buffers of blocks have to live until all requests complete
+        while (ninflight_ != 0)
+            enter(1);
+        rethrow();
+    }
+
+private:
+    static constexpr unsigned c_chain_size = 3;
+
+    struct Request {
+        std::string filename;
+        BlockPtr block;
+        int expected;
+        int error;
+        unsigned ncompletions;
+    };
+
+    static unsigned load_acquire(const unsigned* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+    static void store_release(unsigned* p, unsigned v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+    void map_rings(const io_uring_params& params) {
+        sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+            sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+
+        sq_ring_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+        if (sq_ring_ == MAP_FAILED)
+            throw_error(errno, "can't map io_uring");
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            cq_ring_ = sq_ring_;
+        } else {
+            cq_ring_ = mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+            if (cq_ring_ == MAP_FAILED)
+                throw_error(errno, "can't map io_uring");
+        }
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        auto sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+            throw_error(errno, "can't map io_uring");
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        const auto sq = static_cast<char*>(sq_ring_);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+        const auto cq = static_cast<char*>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        sq_local_tail_ = *sq_tail_;
+    }
+
+    void unmap_rings() {
+        if (sqes_ != nullptr)
+            munmap(sqes_, sqes_size_);
+        if (cq_ring_ != nullptr && cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_)
+            munmap(cq_ring_, cq_size_);
+        if (sq_ring_ != nullptr && sq_ring_ != MAP_FAILED)
+            munmap(sq_ring_, sq_size_);
+        sqes_ = nullptr;
+        sq_ring_ = cq_ring_ = nullptr;
+    }
+
+    void check_support() {
+        const size_t size = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+        std::vector<char> buffer(size, 0);
+        auto probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+        if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, 256) < 0)
+            throw_error(errno, "can't probe io_uring");
+        for (auto op : { IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_CLOSE })
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+                throw_error(ENOTSUP, "io_uring doesn't support file operations");
+    }
+
+    // Opening into fixed slot appeared in kernel 5.15, older kernels ignore
+    // the slot and return ordinary descriptor, so fixed writes would fail.
+    // Opens /dev/null into the first slot and checks that the slot is filled.
+    void check_direct_open() {
+        auto sqe = next_sqe();
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<uintptr_t>("/dev/null");
+        sqe->open_flags = O_WRONLY;
+        sqe->file_index = 1;
+        const auto fd = wait_result();
+        if (fd < 0)
+            throw_error(-fd, "can't open file by io_uring");
+        if (fd > 0) {
+            ::close(fd);
+            throw_error(ENOTSUP, "io_uring doesn't support opening into fixed files");
+        }
+
+        // empty write fails unless the slot holds the file, otherwise
+        // the file got descriptor 0
+        sqe = next_sqe();
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->fd = 0;
+        if (wait_result() < 0) {
+            ::close(fd);
+            throw_error(ENOTSUP, "io_uring doesn't support opening into fixed files");
+        }
+
+        sqe = next_sqe();
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->file_index = 1;
+        const auto result = wait_result();
+        if (result < 0)
+            throw_error(-result, "can't close file by io_uring");
+    }
+
+    // submits the only pending request and returns its result, it's used
+    // before any file is written
+    int wait_result() {
+        store_release(sq_tail_, sq_local_tail_);
+        while (syscall(__NR_io_uring_enter, fd_, npending_, 1u, IORING_ENTER_GETEVENTS, nullptr, 0) < 0)
+            if (errno != EINTR)
+                throw_error(errno, "can't submit to io_uring");
+        npending_ = 0;
+        const auto head = *cq_head_;
+        const auto result = cqes_[head & cq_mask_].res;
+        store_release(cq_head_, head + 1);
+        return result;
+    }
+
+    void register_slots() {
+        // empty slots are filled by open requests
+        std::vector<int> fds(slots_.size(), -1);
+        if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_FILES, fds.data(), fds.size()) < 0)
+            throw_error(errno, "can't register io_uring files");
+    }
+
+    io_uring_sqe* next_sqe() {
+        const auto index = sq_local_tail_ & sq_mask_;
+        auto sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array_[index] = index;
+        ++sq_local_tail_;
+        ++npending_;
+        return sqe;
+    }
+
+    // submits pending requests and waits for min_complete completions
+    void enter(unsigned min_complete) {
+        store_release(sq_tail_, sq_local_tail_);
+        while (true) {
+            const auto flags = min_complete != 0 ? IORING_ENTER_GETEVENTS : 0u;
+            const auto n = syscall(__NR_io_uring_enter, fd_, npending_, min_complete, flags, nullptr, 0);
+            if (n >= 0) {
+                npending_ -= static_cast<unsigned>(n);
+                if (npending_ == 0 || min_complete != 0)
+                    break;
+                continue;
+            }
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EBUSY)
+                throw_error(errno, "can't submit to io_uring");
+            // completion queue has to be emptied first
+            if (reap() == 0)
+                std::this_thread::yield();
+        }
+        reap();
+    }
+
+    size_t reap() {
+        size_t n = 0;
+        auto head = *cq_head_;
+        const auto tail = load_acquire(cq_tail_);
+        for (; head != tail; ++head, ++n) {
+            const auto& cqe = cqes_[head & cq_mask_];
+            complete(static_cast<unsigned>(cqe.user_data), cqe.res);
+        }
+        store_release(cq_head_, head);
+        return n;
+    }
+
+    void complete(unsigned slot, int result) {
+        auto& request = slots_[slot];
+        const auto step = request.ncompletions++;
+        // write reports number of bytes, rest of chain report zero on success
+        const auto failed = result < 0 || (step == 1 && result != request.expected);
+        if (failed && request.error == 0)
+            request.error = result < 0 ? -result : EIO;
+
+        if (request.ncompletions != c_chain_size)
+            return;
+
+        if (request.error != 0 && error_ == 0) {
+            error_ = request.error;
+            failed_ = request.filename;
+        }
+        request.block.reset();
+        free_slots_.push_back(slot);
+        --ninflight_;
+    }
+
+    void rethrow() {
+        if (error_ == 0)
+            return;
+        const auto error = error_;
+        error_ = 0;
+        throw_error(error, "can't write " + failed_);
+    }
+
+    int fd_ { -1 };
+
+    void* sq_ring_ { nullptr };
+    void* cq_ring_ { nullptr };
+    io_uring_sqe* sqes_ { nullptr };
+    size_t sq_size_ { 0 };
+    size_t cq_size_ { 0 };
+    size_t sqes_size_ { 0 };
+
+    unsigned* sq_tail_;
+    unsigned* sq_array_;
+    unsigned sq_mask_;
+    unsigned sq_local_tail_;
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned cq_mask_;
+    io_uring_cqe* cqes_;
+
+    std::vector<Request> slots_;
+    std::vector<unsigned> free_slots_;
+    unsigned npending_ { 0 };   // prepared but not submitted entries
+    size_t ninflight_ { 0 };    // files being written
+
+    int error_ { 0 };
+    std::string failed_;
+};
+
+#endif // BULKMT_HAS_URING
+
+// Helper threads write files by blocking calls, so file thread only queues
+// the bulks. Queue capacity bounds number of files in flight.
+class PoolEngine : public OutputEngine {
+public:
+    PoolEngine(size_t depth, size_t nthreads) : requests_(depth) {
+        threads_.reserve(nthreads);
+        for (auto i = 0u; i < nthreads; ++i)
+            threads_.emplace_back([this] { run(); });
+    }
+
+    ~PoolEngine() override {
+        try {
+            drain();
+        } catch (const std::system_error&) {
+            // owner calls drain to get errors, this one follows a reported error
+        }
+        requests_.close();
+        for (auto& t : threads_)
+            t.join();
+    }
+
+    void write(std::string filename, BlockPtr block) override {
+        rethrow();
+        ninflight_.fetch_add(1, std::memory_order_relaxed);
+        requests_.push({ std::move(filename), std::move(block) });
+    }
+
+    void submit() override {
+        rethrow();
+    }
+
+    void drain() override {
+        done_.wait([this] { return ninflight_.load(std::memory_order_acquire) == 0; });
+        rethrow();
+    }
+
+private:
+    struct Request {
+        std::string filename;
+        BlockPtr block;
+    };
+
+    void run() {
+        Request request;
+        while (requests_.pop(request)) {
+            const auto error = write_file(request);
+            if (error != 0) {
+                std::lock_guard<std::mutex> l { guard_ };
+                if (error_ == 0) {
+                    error_ = error;
+                    failed_ = request.filename;
+                }
+            }
+            request.block.reset();
+            if (ninflight_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                done_.notify_all();
+        }
+    }
+
+    static int write_file(const Request& request) {
+        auto fd = ::open(request.filename.c_str(), c_open_flags, c_open_mode);
+        if (fd < 0)
+            return errno;
+
+        const auto bytes = request.block->bytes();
+        iovec iov { const_cast<char*>(bytes.data()), bytes.size() };
+        off_t offset = 0;
+        auto error = 0;
+        while (iov.iov_len != 0) {
+            auto n = pwritev(fd, &iov, 1, offset);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0) {
+                error = errno;
+                break;
+            }
+            iov.iov_base = static_cast<char*>(iov.iov_base) + n;
+            iov.iov_len -= static_cast<size_t>(n);
+            offset += n;
+        }
+
+        if (::close(fd) != 0 && error == 0)
+            error = errno;
+        return error;
+    }
+
+    void rethrow() {
+        std::lock_guard<std::mutex> l { guard_ };
+        if (error_ == 0)
+            return;
+        const auto error = error_;
+        error_ = 0;
+        throw_error(error, "can't write " + failed_);
+    }
+
+    MpmcQueue<Request> requests_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> ninflight_ { 0 };
+    WaitPoint done_;
+
+    std::mutex guard_;
+    int error_ { 0 };
+    std::string failed_;
+};
+
+} // unnamed namespace
+
+OutputBackend available_backend(OutputBackend backend) {
+    if (backend != OutputBackend::uring)
+        return backend;
+#ifdef BULKMT_HAS_URING
+    try {
+        UringEngine probe { 1 };
+        return backend;
+    } catch (const std::system_error&) {
+        // kernel without io_uring or required operations
+    }
+#endif
+    return OutputBackend::pool;
+}
+
+const char* backend_name(OutputBackend backend) {
+    switch (backend) {
+    case OutputBackend::stream:
+        return "stream";
+    case OutputBackend::uring:
+        return "io_uring";
+    case OutputBackend::pool:
+        return "thread pool";
+    }
+    return "unknown";
+}
+
+OutputEnginePtr make_output_engine(OutputBackend backend, size_t depth, size_t nthreads) {
+#ifdef BULKMT_HAS_URING
+    if (backend == OutputBackend::uring) {
+        try {
+            return std::make_unique<UringEngine>(depth);
+        } catch (const std::system_error&) {
+            // kernel without io_uring or required operations
+        }
+    }
+#endif
+    return std::make_unique<PoolEngine>(depth, std::max<size_t>(nthreads, 1u));
+}
+
+OutputSink::OutputSink(OutputBackend backend, size_t depth, size_t io_threads)
+    : shared_(std::make_shared<Shared>()) {
+    shared_->backend = backend;
+    shared_->depth = depth;
+    shared_->io_threads = io_threads;
+}
+
+OutputSink::~OutputSink() = default;
+
+void OutputSink::operator() (const BlockPtr& block) {
+    using namespace std;
+
+    const auto now = chrono::system_clock::now();
+    const auto now_ns = chrono::duration_cast<chrono::nanoseconds>(now.time_since_epoch());
+    auto filename = ( boost::format { "bulk_%1%_%2%.log"s }
+                        % now_ns.count()
+                        % this_thread::get_id() ).str();
+
+    lock_guard<mutex> l { shared_->guard };
+    if (!shared_->engine)
+        shared_->engine = make_output_engine(shared_->backend, shared_->depth, shared_->io_threads);
+    shared_->engine->write(move(filename), block);
+}
+
+void OutputSink::flush() {
+    std::lock_guard<std::mutex> l { shared_->guard };
+    if (shared_->engine)
+        shared_->engine->submit();
+}
+
+void OutputSink::finish() {
+    std::lock_guard<std::mutex> l { shared_->guard };
+    if (shared_->engine)
+        shared_->engine->drain();
+}
+
+void file_job(const Block& stms) {
+    using namespace std;
+
+    const auto now = chrono::system_clock::now();
+    const auto now_ns = chrono::duration_cast<chrono::nanoseconds>(now.time_since_epoch());
+    const auto filename = ( boost::format { "bulk_%1%_%2%.log"s }
+                                % now_ns.count()
+                                % std::this_thread::get_id() ).str();
+
+    ofstream output { filename };
+
+    // runs keep statements in output format already
+    visit_batches(stms, [&output] (const auto& batch) {
+        const auto bytes = batch.bytes();
+        output.write(bytes.data(), static_cast<streamsize>(bytes.size()));
+    });
+
+    output.flush();
+    output.close();
+}
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "forward.h"
+
+namespace griha {
+
+constexpr size_t c_default_io_depth = 64;
+constexpr size_t c_default_io_threads = 4;  // helper threads of pool engine
+
+// How file threads write bulk files
+enum class OutputBackend {
+    stream, // synchronous ofstream per block
+    uring,  // batched open/write/close submissions to io_uring
+    pool    // helper threads doing open/pwritev/close
+};
+
+// Asynchronous writer of bulk files. Up to depth files are in flight,
+// write waits for a free place when the limit is reached.
+// Failed writes are reported by system_error from next write, submit or drain;
+// destructor waits for files in flight and drops their errors.
+class OutputEngine {
+public:
+    virtual ~OutputEngine() = default;
+
+    // block is kept alive until the file is written and closed
+    virtual void write(std::string filename, BlockPtr block) = 0;
+    // starts writing of collected files
+    virtual void submit() = 0;
+    // waits until all files are written
+    virtual void drain() = 0;
+};
+
+using OutputEnginePtr = std::unique_ptr<OutputEngine>;
+
+// backend that is used when the backend is requested: io_uring is replaced
+// by thread pool if it isn't available
+OutputBackend available_backend(OutputBackend backend);
+const char* backend_name(OutputBackend backend);
+
+// Falls back to thread pool if io_uring isn't available, nthreads is number
+// of helper threads of pool. Stream backend isn't asynchronous and isn't
+// handled by engines.
+OutputEnginePtr make_output_engine(OutputBackend backend, size_t depth = c_default_io_depth,
+                                   size_t nthreads = c_default_io_threads);
+
+// File job of stream backend writing every block into its own file
+// by ofstream.
+void file_job(const Block& stms);
+
+// File job writing every block into its own file through output engine.
+// Copies of the sink share one engine created on the first block, so all
+// file threads submit to one ring or one pool of io_threads helper threads;
+// collected files are submitted when worker has nothing to do.
+// Failed writes throw std::system_error, worker reports them by join.
+class OutputSink {
+public:
+    OutputSink(OutputBackend backend, size_t depth, size_t io_threads = c_default_io_threads);
+    ~OutputSink();
+
+    void operator() (const BlockPtr& block);
+    void flush();
+    // waits until all files are written
+    void finish();
+
+private:
+    struct Shared {
+        OutputBackend backend;
+        size_t depth;
+        size_t io_threads;
+
+        std::mutex guard;   // engine isn't thread safe
+        OutputEnginePtr engine;
+    };
+
+    std::shared_ptr<Shared> shared_;
+};
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,353 @@
+#include "parallel_reader.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "block.h"
+#include "chunk_reader.h"
+#include "line_scanner.h"
+#include "reader_subscriber.h"
+
+namespace griha {
+
+namespace {
+
+// Brace line of chunk and number of statements between it and the previous one
+struct Brace {
+    size_t line;
+    size_t nstatements;
+    LineKind kind;
+};
+
+// Reader state at the beginning of chunk
+struct State {
+    enum class Mode : uint8_t { initial, block, error };
+
+    Mode mode { Mode::initial };
+    size_t count { 0 };         // statements of open block in initial mode
+    size_t level { 0 };         // nesting in block mode
+    size_t nstatements { 0 };   // statements of open explicit block
+
+    // statements have been read after block had been started
+    bool open() const { return mode == Mode::block || (mode == Mode::initial && count != 0); }
+};
+
+struct Event {
+    BlockPtr block;
+    bool unexpected_eof;
+};
+
+struct Chunk {
+    const char* begin;
+    const char* end;
+
+    // scanning
+    std::vector<Brace> braces;
+    size_t nlines { 0 };
+    size_t nstatements { 0 };
+    size_t tail { 0 }; // statements behind the last brace
+
+    // sequential pass
+    State entry;
+    uint64_t first_id { 0 }; // id of the previous block
+
+    // parsing
+    std::vector<Event> events;
+    bool done { false };
+};
+
+void scan_chunk(Chunk& chunk) {
+    RangeLines lines { chunk.begin, chunk.end };
+    std::string_view line;
+    LineKind kind;
+    size_t nstatements = 0;
+    while (lines.next_line(line, kind)) {
+        if (kind == LineKind::statement) {
+            ++nstatements;
+        } else {
+            chunk.braces.push_back({ chunk.nlines, nstatements, kind });
+            chunk.nstatements += nstatements;
+            nstatements = 0;
+        }
+        ++chunk.nlines;
+    }
+    chunk.tail = nstatements;
+    chunk.nstatements += nstatements;
+}
+
+// Goes through braces of all chunks like the reader goes through lines.
+// Statements between braces are taken into account by their number.
+// Every block is counted for the chunk it starts in to find block ids.
+// Returns true if the input has unexpected end of block.
+bool resolve_states(std::vector<Chunk>& chunks, size_t block_size, Reader::Metrics& metrics) {
+    using Mode = State::Mode;
+
+    State state;
+    size_t open_chunk = 0; // chunk where the open block starts
+    std::vector<uint64_t> nblocks(chunks.size(), 0);
+
+    const auto statements = [&] (size_t k, size_t n) {
+        metrics.nstatements += n;
+        if (n == 0)
+            return;
+        if (state.mode == Mode::block) {
+            state.nstatements += n;
+            return;
+        }
+
+        const auto count = state.count;
+        const auto total = count + n;
+        const auto completed = block_size != 0 ? total / block_size : 0;
+        if (completed != 0) {
+            ++nblocks[count != 0 ? open_chunk : k];
+            nblocks[k] += completed - 1;
+        }
+        state.count = block_size != 0 ? total % block_size : total;
+        if (state.count != 0 && (completed != 0 || count == 0))
+            open_chunk = k;
+    };
+
+    auto error = false;
+    for (size_t k = 0; k < chunks.size(); ++k) {
+        auto& chunk = chunks[k];
+        if (error) {
+            chunk.entry.mode = Mode::error;
+            continue;
+        }
+
+        chunk.entry = state;
+        for (auto& brace : chunk.braces) {
+            statements(k, brace.nstatements);
+            if (state.mode == Mode::initial) {
+                if (brace.kind == LineKind::block_end) {
+                    // reader stops at this line
+                    metrics.nlines += brace.line + 1;
+                    error = true;
+                    break;
+                }
+                if (state.count != 0)
+                    ++nblocks[open_chunk];
+                state = { Mode::block, 0, 1, 0 };
+                open_chunk = k;
+            } else if (brace.kind == LineKind::block_begin) {
+                ++state.level;
+            } else if (--state.level == 0) {
+                if (state.nstatements != 0)
+                    ++nblocks[open_chunk];
+                state = State {};
+            }
+        }
+
+        if (!error) {
+            statements(k, chunk.tail);
+            metrics.nlines += chunk.nlines;
+        }
+    }
+
+    // in initial state the end of the input triggers end of block
+    if (!error && state.mode == Mode::initial && state.count != 0)
+        ++nblocks[open_chunk];
+
+    for (size_t k = 0; k < chunks.size(); ++k) {
+        chunks[k].first_id = metrics.nblocks;
+        metrics.nblocks += nblocks[k];
+    }
+    return error;
+}
+
+// Builds blocks starting in the chunk; the last one is continued behind
+// the end of the chunk until it's completed
+void parse_chunk(Chunk& chunk, const char* input_end, size_t block_size,
+                 const InputChunkPtr& input, BlockBuilder& builder) {
+    using Mode = State::Mode;
+
+    auto state = chunk.entry;
+    if (state.mode == Mode::error)
+        return;
+
+    // open block is built by one of previous chunks
+    auto owned = !state.open();
+    auto id = chunk.first_id;
+
+    // next block is built by this chunk if it starts in the chunk
+    const auto complete = [&] (const char* next_begin) {
+        if (owned && !builder.empty())
+            chunk.events.push_back({ builder.build(++id), false });
+        owned = next_begin < chunk.end;
+    };
+
+    RangeLines lines { chunk.begin, input_end };
+    std::string_view line;
+    LineKind kind;
+    while (lines.position() < chunk.end || (owned && state.open())) {
+        const auto line_begin = lines.position();
+        if (!lines.next_line(line, kind)) {
+            if (state.mode == Mode::initial) {
+                // in initial state the end of the input triggers end of block
+                complete(input_end);
+            } else if (owned && !builder.empty()) {
+                chunk.events.push_back({ builder.build(id + 1), true });
+            }
+            break;
+        }
+
+        if (state.mode == Mode::initial) {
+            if (kind == LineKind::block_end)
+                break; // unexpected end of block, open block is dropped
+            if (kind == LineKind::block_begin) {
+                // explicit block starts at this line
+                complete(line_begin);
+                state = { Mode::block, 0, 1, 0 };
+                continue;
+            }
+            if (owned)
+                builder.append(line, input);
+            if (++state.count == block_size) {
+                complete(lines.position());
+                state.count = 0;
+            }
+        } else if (kind == LineKind::block_begin) {
+            ++state.level;
+        } else if (kind == LineKind::block_end) {
+            if (--state.level == 0) {
+                complete(lines.position());
+                state = State {};
+            }
+        } else if (owned) {
+            builder.append(line, input);
+        }
+    }
+
+    builder.clear();
+}
+
+// runs job for every chunk by nthreads threads
+template <typename Job>
+void for_each_chunk(size_t nchunks, size_t nthreads, Job&& job) {
+    std::atomic<size_t> next { 0 };
+    std::vector<std::thread> threads;
+    for (auto i = 0u; i < nthreads; ++i)
+        threads.emplace_back([&] {
+            for (auto k = next++; k < nchunks; k = next++)
+                job(k);
+        });
+    for (auto& t : threads)
+        t.join();
+}
+
+} // unnamed namespace
+
+bool parse_parallel(int fd, size_t block_size, size_t nthreads, size_t chunk_size,
+                    const std::vector<ReaderSubscriberPtr>& subscribers, Reader::Metrics& metrics) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        return false;
+
+    const auto offset = lseek(fd, 0, SEEK_CUR);
+    if (offset < 0 || offset >= st.st_size)
+        return false;
+
+    const auto size = static_cast<size_t>(st.st_size - offset);
+    const auto nchunks = size / std::max<size_t>(chunk_size, 1u);
+    if (nchunks < 2)
+        return false;
+
+    InputChunkPtr input = InputChunk::map(fd, static_cast<size_t>(offset), size);
+    if (!input)
+        return false;
+    // leave descriptor in the same state as if the file has been read
+    lseek(fd, 0, SEEK_END);
+
+    // chunks start at line boundaries
+    const auto data = input->data();
+    const auto end = data + size;
+    std::vector<Chunk> chunks(nchunks);
+    auto begin = data;
+    for (size_t k = 0; k < nchunks; ++k) {
+        auto chunk_end = end;
+        if (k + 1 != nchunks) {
+            chunk_end = std::max(data + size / nchunks * (k + 1), begin);
+            if (chunk_end != data && chunk_end[-1] != '\n') {
+                auto nl = static_cast<const char*>(std::memchr(chunk_end, '\n', static_cast<size_t>(end - chunk_end)));
+                chunk_end = nl != nullptr ? nl + 1 : end;
+            }
+        }
+        chunks[k].begin = begin;
+        chunks[k].end = chunk_end;
+        begin = chunk_end;
+    }
+
+    metrics = {};
+    metrics.nchunks = 1;
+
+    for_each_chunk(nchunks, nthreads, [&chunks] (size_t k) { scan_chunk(chunks[k]); });
+
+    const auto error = resolve_states(chunks, block_size, metrics);
+
+    // parsing runs ahead of notification by limited number of chunks
+    const auto window = nthreads * 2;
+    std::mutex guard;
+    std::condition_variable cv;
+    size_t nnotified = 0;
+    std::atomic<size_t> nallocations { 0 };
+
+    size_t next = 0;
+    std::vector<std::thread> parsers;
+    for (auto i = 0u; i < nthreads; ++i)
+        parsers.emplace_back([&] {
+            BlockBuilder builder;
+            while (true) {
+                size_t k;
+                {
+                    std::unique_lock<std::mutex> l { guard };
+                    if (next == nchunks)
+                        break;
+                    k = next++;
+                    cv.wait(l, [&] { return k < nnotified + window; });
+                }
+                parse_chunk(chunks[k], end, block_size, input, builder);
+                {
+                    std::lock_guard<std::mutex> l { guard };
+                    chunks[k].done = true;
+                }
+                cv.notify_all();
+            }
+            nallocations += builder.nallocations();
+        });
+
+    for (auto& chunk : chunks) {
+        std::vector<Event> events;
+        {
+            std::unique_lock<std::mutex> l { guard };
+            cv.wait(l, [&chunk] { return chunk.done; });
+            events.swap(chunk.events);
+            ++nnotified;
+        }
+        cv.notify_all();
+
+        for (auto& event : events)
+            for (auto& subscriber : subscribers) {
+                if (event.unexpected_eof)
+                    subscriber->on_unexpected_eof(event.block);
+                else
+                    subscriber->on_block(event.block);
+            }
+    }
+    for (auto& t : parsers)
+        t.join();
+
+    metrics.nallocations = nallocations;
+    if (error)
+        std::cerr << "unexpected end of block" << std::endl;
+    return true;
+}
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "forward.h"
+#include "reader.h"
+
+namespace griha {
+
+// Parses regular file by several threads and notifies subscribers in the
+// same order and with the same blocks as the sequential reader does.
+// Returns false without reading anything if the input isn't a regular file
+// or it's too small to be split into several chunks.
+//
+// The file is mapped and split into chunks at line boundaries.
+// 1. Chunks are scanned in parallel; only positions of brace lines and
+//    numbers of statements between them are kept.
+// 2. The sequential pass goes through braces only and finds the reader
+//    state at the beginning of every chunk and ids of its blocks.
+// 3. Chunks are parsed in parallel from known states. A chunk builds blocks
+//    starting in it, the last one may be continued into next chunks.
+//    Blocks are handed to subscribers by the calling thread chunk by chunk.
+bool parse_parallel(int fd, size_t block_size, size_t nthreads, size_t chunk_size,
+                    const std::vector<ReaderSubscriberPtr>& subscribers, Reader::Metrics& metrics);
+
+} // namespace griha
\ No newline at end of file
@@ -1,201 +1,429 @@
 #include "reader.h"
 
 #include <algorithm>
+#include <cstring>
 #include <string>
 #include <string_view>
+#include <variant>
 
+#include "block.h"
+#include "chunk_reader.h"
+#include "histogram.h"
+#include "line_scanner.h"
+#include "parallel_reader.h"
 #include "reader_subscriber.h"
-#include "statement_factory.h"
+#include "trace.h"
 
 namespace griha {
 
 namespace {
 
-using namespace std::string_view_literals;
+constexpr size_t c_batch_size = 1024; // lines
 
-constexpr auto c_explicit_block_begin   = "{"sv;
-constexpr auto c_explicit_block_end     = "}"sv;
+using Clock = std::chrono::steady_clock;
 
-bool is_block_begin(std::string_view line) {
-    using namespace std;
-    return line == c_explicit_block_begin;
-}
+// Lines of a stream; kind of line is found by comparison.
+// getline can't be interrupted, so deadline is ignored.
+class StreamSource {
+public:
+    explicit StreamSource(std::istream& input) : input_(input) {}
 
-bool is_block_end(std::string_view line) {
-    using namespace std;
-    return line == c_explicit_block_end;
-}
+    bool next_line(std::string_view& line, LineKind& kind) {
+        if (!getline(input_, buffer_))
+            return false;
+        line = buffer_;
+        kind = classify_line(line);
+        return true;
+    }
 
-} // unnamed namespace
+    const InputChunkPtr& chunk() const { return no_chunk_; }
+    size_t nchunks() const { return 0; }
 
-struct ReaderState : std::enable_shared_from_this<ReaderState> {
-    virtual ~ReaderState() {}
-    virtual bool process(std::istream& line) = 0;
+    void set_deadline(Clock::time_point) {}
+    bool timed_out() const { return false; }
+
+private:
+    std::istream& input_;
+    std::string buffer_;
+    const InputChunkPtr no_chunk_;
 };
-using ReaderStatePtr = std::shared_ptr<ReaderState>;
 
-struct ReaderImpl {
+// Lines of input fed by portions. Complete lines are views into the current
+// portion; the line crossing the end of a portion is copied and completed
+// by the next one.
+class FeedSource {
+public:
+    // bytes must stay valid until lines of the portion are handled
+    void portion(std::string_view bytes) {
+        auto begin = bytes.data();
+        const auto end = begin + bytes.size();
+        ++nportions_;
+
+        if (!partial_.empty()) {
+            const auto nl = static_cast<const char*>(std::memchr(begin, '\n', bytes.size()));
+            if (nl == nullptr) {
+                partial_.append(bytes);
+                lines_.reset(end, end);
+                return;
+            }
+            head_.swap(partial_);
+            head_.append(begin, nl);
+            partial_.clear();
+            has_head_ = true;
+            begin = nl + 1;
+        }
 
-    inline ReaderImpl(size_t bsize)
-        : state(nullptr)
-        , block_size(bsize) {}
+        const auto last = static_cast<const char*>(memrchr(begin, '\n', static_cast<size_t>(end - begin)));
+        const auto lines_end = last != nullptr ? last + 1 : begin;
+        lines_.reset(begin, lines_end);
+        partial_.assign(lines_end, end);
+    }
 
-    ReaderStatePtr state;
-    const size_t block_size;
+    // the partial line is the last one
+    void finish() { finished_ = true; }
+    bool finished() const { return finished_; }
 
-    std::vector<ReaderSubscriberPtr> subscribers;
+    void restart() {
+        lines_.reset(nullptr, nullptr);
+        partial_.clear();
+        has_head_ = finished_ = false;
+        nportions_ = 0;
+    }
 
-    StatementFactory statement_factory;
-    StatementContainer statements;
+    bool next_line(std::string_view& line, LineKind& kind) {
+        if (has_head_) {
+            has_head_ = false;
+            line = head_;
+            kind = classify_line(line);
+            return true;
+        }
 
-    Reader::Metrics metrics;
+        if (lines_.next_line(line, kind))
+            return true;
 
-    template <typename State> State& change_state(); 
+        if (!finished_ || partial_.empty())
+            return false;
 
-    bool process(std::istream& is);
-    void process(std::string line);
+        head_.swap(partial_);
+        partial_.clear();
+        line = head_;
+        kind = classify_line(line);
+        return true;
+    }
 
-    bool read_line(std::istream& is, std::string& line);
+    const InputChunkPtr& chunk() const { return no_chunk_; }
+    size_t nchunks() const { return nportions_; }
 
-    void notify_block();
-    void notify_unexpected_eof();
+    void set_deadline(Clock::time_point) {}
+    bool timed_out() const { return false; }
+
+private:
+    RangeLines lines_;
+    std::string partial_;  // the line isn't terminated yet
+    std::string head_;     // the line completed by current portion
+    bool has_head_ { false };
+    bool finished_ { false };
+    size_t nportions_ { 0 };
+    const InputChunkPtr no_chunk_;
 };
 
-struct InitialState : ReaderState {
-    inline explicit InitialState(ReaderImpl& r_impl)
-        : reader_impl(r_impl) {}
+// source has no more lines now, but input isn't ended
+template <typename Source>
+bool drained(const Source&) { return false; }
+
+bool drained(const FeedSource& source) { return !source.finished(); }
+
+} // unnamed namespace
+
+// States are alternatives of variant stored in the reader, so transition
+// doesn't allocate. A state handles lines in a loop until it's changed.
+struct InitialState {
+    static constexpr auto c_name = "initial";
+
+    template <typename Source>
+    bool process(ReaderImpl& reader_impl, Source& source);
 
-    bool process(std::istream& line) override;
+    // ends dynamic block
+    template <typename Source>
+    void flush(ReaderImpl& reader_impl, Source& source);
 
-    ReaderImpl& reader_impl;
     size_t count {};
 };
 
-struct BlockState : ReaderState {
-    inline BlockState(ReaderImpl& r_impl) 
-        : reader_impl(r_impl) {}
+struct BlockState {
+    static constexpr auto c_name = "block";
 
-    bool process(std::istream& line) override;
+    template <typename Source>
+    bool process(ReaderImpl& reader_impl, Source& source);
 
-    ReaderImpl& reader_impl;
     size_t level { 1 };
 };
 
-struct ErrorState : ReaderState {
-    inline ErrorState(ReaderImpl& r_impl)
-        : reader_impl(r_impl) {}
+struct ErrorState {
+    static constexpr auto c_name = "error";
 
-    bool process(std::istream& line) override;
+    template <typename Source>
+    bool process(ReaderImpl& reader_impl, Source& source);
 
-    ReaderImpl& reader_impl;
     std::string error;
+    bool reported { false };
+};
+
+using ReaderState = std::variant<InitialState, BlockState, ErrorState>;
+
+struct ReaderImpl {
+
+    inline ReaderImpl(size_t bsize, std::chrono::milliseconds age)
+        : initial_block_size(bsize)
+        , block_size(bsize)
+        , max_age(age) {}
+
+    ReaderState state;
+    const size_t initial_block_size;
+    size_t block_size;  // changed by sizer
+    const Clock::duration max_age;
+
+    BlockSizerPtr sizer;
+    size_t nsized_blocks; // dynamic blocks of current size
+
+    // ages are measured only if max age is set
+    Clock::time_point block_start;
+    Histogram block_ages;
+
+    std::vector<ReaderSubscriberPtr> subscribers;
+
+    BlockBuilder builder;
+
+    Reader::Metrics metrics;
+
+    // state object must not be used after the change
+    template <typename State> State& change_state(); 
+
+    template <typename Source> void run(Source& source);
+    void start();
+    template <typename Source> void stop(Source& source);
+
+    // state is kept between portions of fed input
+    FeedSource feed_source;
+    bool feeding { false };
+    size_t nallocations_at_start;
+
+    // handles next batch of lines; returns false at the end of input
+    template <typename Source> bool process(Source& source);
+    void process(std::string_view line, const InputChunkPtr& chunk);
+
+    template <typename Source>
+    bool read_line(Source& source, std::string_view& line, LineKind& kind);
+
+    void notify_block();
+    void notify_unexpected_eof();
+
+    void adapt_block_size();
+
+    void update_block_age_metrics();
+    void update_block_size_metrics();
 };
 
 template <typename State>
 State& ReaderImpl::change_state() {
-    // for further optimization it looks pretty to create states pool
-    state = std::make_shared<State>(*this);
-    return dynamic_cast<State&>(*state);
+    BULKMT_TRACE_INSTANT("reader", State::c_name);
+    return state.emplace<State>();
 } 
 
-bool ReaderImpl::process(std::istream& is) {
-    auto save_state_ptr = state->shared_from_this(); // protect against unexpected deletion
-    return state->process(is);
+template <typename Source>
+void ReaderImpl::run(Source& source) {
+    start();
+    while (process(source)) {
+        // do nothing
+    }
+    stop(source);
+}
+
+void ReaderImpl::start() {
+    metrics = {};
+    builder.clear();
+    nallocations_at_start = builder.nallocations();
+    block_size = initial_block_size;
+    nsized_blocks = 0;
+    change_state<InitialState>();
+}
+
+template <typename Source>
+void ReaderImpl::stop(Source& source) {
+    metrics.nallocations = builder.nallocations() - nallocations_at_start;
+    metrics.nchunks = source.nchunks();
+    update_block_age_metrics();
+    update_block_size_metrics();
+}
+
+template <typename Source>
+bool ReaderImpl::process(Source& source) {
+    BULKMT_TRACE_SPAN("reader", "batch");
+    return std::visit([this, &source] (auto& s) { return s.process(*this, source); }, state);
 }
 
-void ReaderImpl::process(std::string line) {
+void ReaderImpl::process(std::string_view line, const InputChunkPtr& chunk) {
     ++metrics.nstatements;
-    statements.push_back(statement_factory.create(std::move(line)));
+    if (max_age != Clock::duration::zero() && builder.empty())
+        block_start = Clock::now();
+    builder.append(line, chunk);
 }
 
-bool ReaderImpl::read_line(std::istream& is, std::string& line) {
-    if (!getline(is, line))
+template <typename Source>
+bool ReaderImpl::read_line(Source& source, std::string_view& line, LineKind& kind) {
+    if (!source.next_line(line, kind))
         return false;
-    
+
     ++metrics.nlines;
     return true;
 }
 
 void ReaderImpl::notify_block() {
-    if (statements.empty())
+    if (builder.empty())
         return; // empty block doesn't require notification
 
+    BULKMT_TRACE_SPAN("reader", "notify");
     ++metrics.nblocks;
+    if (max_age != Clock::duration::zero()) {
+        const auto age = Clock::now() - block_start;
+        block_ages.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(age).count()));
+    }
 
+    const auto block = builder.build(metrics.nblocks);
     for (auto& subscriber : subscribers)
-        subscriber->on_block(statements);
-    statements.clear();
+        subscriber->on_block(block);
 }
 
 void ReaderImpl::notify_unexpected_eof() {
-    if (statements.empty())
+    if (builder.empty())
         return; // empty block doesn't require notification
 
+    const auto block = builder.build(metrics.nblocks + 1);
     for (auto& subscriber : subscribers)
-        subscriber->on_unexpected_eof(statements);
+        subscriber->on_unexpected_eof(block);
+}
+
+void ReaderImpl::adapt_block_size() {
+    ++nsized_blocks;
+    const auto size = std::max<size_t>(sizer->next_size(block_size), 1u);
+    if (size != block_size) {
+        metrics.block_sizes[block_size] += nsized_blocks;
+        nsized_blocks = 0;
+        block_size = size;
+    }
+}
+
+void ReaderImpl::update_block_size_metrics() {
+    if (nsized_blocks != 0)
+        metrics.block_sizes[block_size] += nsized_blocks;
+}
+
+void ReaderImpl::update_block_age_metrics() {
+    using std::chrono::microseconds;
+
+    metrics.block_age.p50 = microseconds(block_ages.percentile(50));
+    metrics.block_age.p90 = microseconds(block_ages.percentile(90));
+    metrics.block_age.p99 = microseconds(block_ages.percentile(99));
+    metrics.block_age.max = microseconds(block_ages.max());
+    block_ages.clear();
+}
+
+template <typename Source>
+void InitialState::flush(ReaderImpl& reader_impl, Source& source) {
+    reader_impl.notify_block();
+    if (count != 0 && reader_impl.sizer)
+        reader_impl.adapt_block_size();
+    count = 0;
+    source.set_deadline(c_no_deadline);
 }
 
-bool InitialState::process(std::istream& input) {
+template <typename Source>
+bool InitialState::process(ReaderImpl& reader_impl, Source& source) {
     using namespace std;
 
-    string line;
-    if (!reader_impl.read_line(input, line)) {
-        // in initial state the end of the stream triggers end of block
-        reader_impl.notify_block();
-        return false; // end of file or another error
-    }
-    
-    if (is_block_end(line)) {
-        reader_impl.change_state<ErrorState>().error = "unexpected end of block"s;
-    } else if (is_block_begin(line)) {
-        // in initial state start of explicit block triggers end of block
-        reader_impl.notify_block();
-        reader_impl.change_state<BlockState>();
-    } else {
-        reader_impl.process(std::move(line));
-        if (++count == reader_impl.block_size) {
-            // fixed block size has been reached
+    string_view line;
+    LineKind kind;
+    for (auto i = 0u; i < c_batch_size; ++i) {
+        if (!reader_impl.read_line(source, line, kind)) {
+            if (source.timed_out()) {
+                // dynamic block is too old to wait for next statements
+                ++reader_impl.metrics.nexpired;
+                flush(reader_impl, source);
+                return true;
+            }
+            if (drained(source))
+                return false; // the rest of input comes later
+            // in initial state the end of the stream triggers end of block
             reader_impl.notify_block();
-            count = 0;
+            return false; // end of file or another error
+        }
+
+        if (kind == LineKind::block_end) {
+            reader_impl.change_state<ErrorState>().error = "unexpected end of block"s;
+            return true;
+        } else if (kind == LineKind::block_begin) {
+            // in initial state start of explicit block triggers end of block
+            flush(reader_impl, source);
+            reader_impl.change_state<BlockState>();
+            return true;
+        } else {
+            reader_impl.process(line, source.chunk());
+            if (++count == reader_impl.block_size) {
+                // fixed block size has been reached
+                flush(reader_impl, source);
+            } else if (count == 1 && reader_impl.max_age != Clock::duration::zero()) {
+                source.set_deadline(reader_impl.block_start + reader_impl.max_age);
+            }
         }
     }
 
     return true;
 }
 
-bool BlockState::process(std::istream& input) {
+template <typename Source>
+bool BlockState::process(ReaderImpl& reader_impl, Source& source) {
     using namespace std;
 
-    string line;
-    if (!reader_impl.read_line(input, line)) {
-        reader_impl.notify_unexpected_eof();
-        return false; // end of file or another error
-    }
+    string_view line;
+    LineKind kind;
+    for (auto i = 0u; i < c_batch_size; ++i) {
+        if (!reader_impl.read_line(source, line, kind)) {
+            if (!drained(source))
+                reader_impl.notify_unexpected_eof();
+            return false; // end of file or another error
+        }
 
-    if (is_block_begin(line)) {
-        // nested explicit blocks are ignored but correction of syntax is required
-        ++level;
-    } else if (is_block_end(line)) {
-        if (--level == 0) {
-            // explicit block has been ended
-            // block has statements - notify about end of block
-            reader_impl.notify_block();
-            reader_impl.change_state<InitialState>();
+        if (kind == LineKind::block_begin) {
+            // nested explicit blocks are ignored but correction of syntax is required
+            ++level;
+        } else if (kind == LineKind::block_end) {
+            if (--level == 0) {
+                // explicit block has been ended
+                // block has statements - notify about end of block
+                reader_impl.notify_block();
+                reader_impl.change_state<InitialState>();
+                return true;
+            }
+        } else {
+            reader_impl.process(line, source.chunk());
         }
-    } else {
-        reader_impl.process(std::move(line));
     }
 
     return true;
 }
 
-bool ErrorState::process([[maybe_unused]] std::istream& is) {
-    std::cerr << error << std::endl;
+template <typename Source>
+bool ErrorState::process(ReaderImpl&, Source&) {
+    // the rest of input is ignored
+    if (!reported)
+        std::cerr << error << std::endl;
+    reported = true;
     return false;
 }
 
-Reader::Reader(size_t block_size) 
-    : priv_(std::make_unique<ReaderImpl>(block_size)) {}
+Reader::Reader(size_t block_size, std::chrono::milliseconds max_age)
+    : priv_(std::make_unique<ReaderImpl>(block_size, max_age)) {}
 
 Reader::~Reader() = default;
 Reader::Reader(Reader&&) = default;
@@ -208,15 +436,62 @@ void Reader::subscribe(ReaderSubscriberPtr subscriber) {
         subscribers.push_back(std::move(subscriber));
 }
 
+void Reader::adapt_block_size(BlockSizerPtr sizer) {
+    priv_->sizer = std::move(sizer);
+}
+
 auto Reader::run(std::istream& input) -> const Metrics& {
-    priv_->metrics = {};
-    priv_->statements.clear();
-    priv_->change_state<InitialState>();
-    while (priv_->process(input)) {
+    StreamSource source { input };
+    priv_->run(source);
+
+    return priv_->metrics;
+}
+
+void Reader::feed(std::string_view bytes) {
+    auto& impl = *priv_;
+    if (!impl.feeding) {
+        impl.start();
+        impl.feed_source.restart();
+        impl.feeding = true;
+    }
+
+    impl.feed_source.portion(bytes);
+    while (impl.process(impl.feed_source)) {
         // do nothing
     }
+}
+
+auto Reader::finish() -> const Metrics& {
+    auto& impl = *priv_;
+    if (!impl.feeding) {
+        impl.start();
+        impl.feed_source.restart();
+    }
+
+    impl.feed_source.finish();
+    while (impl.process(impl.feed_source)) {
+        // do nothing
+    }
+    impl.stop(impl.feed_source);
+    impl.feeding = false;
+
+    return impl.metrics;
+}
+
+auto Reader::run(int fd) -> const Metrics& {
+    ChunkReader chunk_reader { fd };
+    priv_->run(chunk_reader);
 
     return priv_->metrics;
 }
 
+auto Reader::run(int fd, size_t nthreads, size_t chunk_size) -> const Metrics& {
+    // sizes of blocks depend on timing of the sequential reading
+    if (nthreads > 1 && !priv_->sizer && parse_parallel(fd, priv_->initial_block_size, nthreads, chunk_size,
+                                                         priv_->subscribers, priv_->metrics))
+        return priv_->metrics;
+
+    return run(fd);
+}
+
 } // namespace griha
\ No newline at end of file
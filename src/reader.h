@@ -1,23 +1,41 @@
 #pragma once
 
+#include <chrono>
 #include <iostream>
+#include <map>
+#include <string_view>
 #include <vector>
 #include <memory>
 
+#include "block_sizer.h"
 #include "forward.h"
 
 namespace griha {
 
+constexpr size_t c_parse_chunk_size = 1u << 20;
+
 class Reader {
 public:
     struct Metrics {
         size_t nlines;
         size_t nstatements;
         size_t nblocks;
+        size_t nchunks;
+        size_t nallocations; // heap allocations for blocks
+        size_t nexpired;     // blocks flushed by max age before reaching block size
+        // time from the first statement of block to notification;
+        // measured only if max age of block is set
+        struct {
+            std::chrono::microseconds p50, p90, p99, max;
+        } block_age;
+        // number of dynamic blocks by size limit chosen by block sizer
+        std::map<size_t, size_t> block_sizes;
     };
 
 public:
-    Reader(size_t block_size);
+    // if max_age isn't zero, a dynamic block isn't kept waiting for next
+    // statements longer than max_age when input is read from descriptor
+    explicit Reader(size_t block_size, std::chrono::milliseconds max_age = {});
     ~Reader();
 
     Reader(Reader&&);
@@ -28,8 +46,23 @@ public:
     Reader& operator=(const Reader&) = delete;
 
     void subscribe(ReaderSubscriberPtr subscriber);
+    // size of dynamic blocks is changed by the sizer while reading;
+    // input is always read sequentially then
+    void adapt_block_size(BlockSizerPtr sizer);
 
     const Metrics& run(std::istream& input);
+    // reads input by large chunks, statements refer to the chunks without copying
+    const Metrics& run(int fd);
+    // parses regular file by nthreads threads with the same result as run(fd);
+    // other inputs are read sequentially
+    const Metrics& run(int fd, size_t nthreads, size_t chunk_size = c_parse_chunk_size);
+
+    // Push interface: input is handed by portions of any size, subscribers
+    // are notified as soon as blocks are complete. Bytes aren't used after
+    // feed returns. finish ends the input as the end of file does and makes
+    // the reader ready for the next input. Max age of block isn't applied.
+    void feed(std::string_view bytes);
+    const Metrics& finish();
 
 private:
     std::unique_ptr<struct ReaderImpl> priv_;
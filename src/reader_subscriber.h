@@ -6,8 +6,8 @@ namespace griha {
 
 struct ReaderSubscriber {
     virtual ~ReaderSubscriber() {}
-    virtual void on_block(const StatementContainer&) = 0;
-    virtual void on_unexpected_eof(const StatementContainer&) = 0;
+    virtual void on_block(const BlockPtr&) = 0;
+    virtual void on_unexpected_eof(const BlockPtr&) = 0;
 };
 
 } // namespace griha
\ No newline at end of file
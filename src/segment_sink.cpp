@@ -0,0 +1,145 @@
+#include "segment_sink.h"
+
+#include <cerrno>
+#include <iostream>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "block.h"
+
+namespace griha {
+
+namespace {
+
+constexpr size_t c_index_buffer_size = 4096; // records
+
+void write_all(int fd, const char* data, size_t size) {
+    while (size != 0) {
+        auto n = ::write(fd, data, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            throw std::system_error { errno, std::generic_category(), "can't write segment" };
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+}
+
+int open_file(const std::string& name) {
+    auto fd = ::open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw std::system_error { errno, std::generic_category(), "can't open " + name };
+    return fd;
+}
+
+// segments can be created in the directory
+void check_dir(const std::string& dir) {
+    struct stat st;
+    if (::stat(dir.c_str(), &st) != 0)
+        throw std::system_error { errno, std::generic_category(), "can't use segment directory " + dir };
+    if (!S_ISDIR(st.st_mode))
+        throw std::system_error { ENOTDIR, std::generic_category(), "can't use segment directory " + dir };
+    if (::access(dir.c_str(), W_OK | X_OK) != 0)
+        throw std::system_error { errno, std::generic_category(), "can't use segment directory " + dir };
+}
+
+} // unnamed namespace
+
+SegmentWriter::SegmentWriter(const SegmentOptions& options, size_t writer_id)
+    : options_(options)
+    , writer_id_(writer_id) {
+    index_.reserve(c_index_buffer_size);
+}
+
+SegmentWriter::~SegmentWriter() {
+    try {
+        close();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void SegmentWriter::open() {
+    using namespace std::chrono;
+
+    const auto now_ns = duration_cast<nanoseconds>(system_clock::now().time_since_epoch());
+    const auto base = options_.dir + "/bulk_" + std::to_string(now_ns.count())
+        + "_" + std::to_string(writer_id_);
+
+    fd_ = open_file(base + ".seg");
+    index_fd_ = open_file(base + ".idx");
+    size_ = 0;
+    opened_ = steady_clock::now();
+    ++nsegments_;
+}
+
+void SegmentWriter::flush_index() {
+    if (index_.empty())
+        return;
+    write_all(index_fd_, reinterpret_cast<const char*>(index_.data()),
+              index_.size() * sizeof(IndexRecord));
+    index_.clear();
+}
+
+void SegmentWriter::close() {
+    if (fd_ < 0)
+        return;
+
+    // files are closed even if index can't be written
+    try {
+        flush_index();
+    } catch (...) {
+        ::close(index_fd_);
+        ::close(fd_);
+        fd_ = index_fd_ = -1;
+        throw;
+    }
+    ::close(index_fd_);
+    ::close(fd_);
+    fd_ = index_fd_ = -1;
+}
+
+void SegmentWriter::write(const Block& block) {
+    if (fd_ >= 0 && (size_ >= options_.max_size
+            || std::chrono::steady_clock::now() - opened_ >= options_.max_age))
+        close();
+    if (fd_ < 0)
+        open();
+
+    const auto bytes = block.bytes();
+    write_all(fd_, bytes.data(), bytes.size());
+
+    index_.push_back({ block.id(), size_ });
+    if (index_.size() == c_index_buffer_size)
+        flush_index();
+
+    size_ += bytes.size();
+}
+
+SegmentSink::SegmentSink(SegmentOptions options)
+    : shared_(std::make_shared<Shared>()) {
+    check_dir(options.dir);
+    shared_->options = std::move(options);
+}
+
+// copy gets its own writer
+SegmentSink::SegmentSink(const SegmentSink& other)
+    : shared_(other.shared_) {}
+
+SegmentSink::~SegmentSink() = default;
+
+void SegmentSink::operator() (const Block& block) {
+    if (!writer_)
+        writer_ = std::make_unique<SegmentWriter>(shared_->options, shared_->nwriters++);
+    writer_->write(block);
+}
+
+void SegmentSink::finish() {
+    if (writer_)
+        writer_->close();
+}
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "forward.h"
+
+namespace griha {
+
+struct SegmentOptions {
+    std::string dir { "." };
+    size_t max_size { 64u << 20 };                   // bytes
+    std::chrono::seconds max_age { 60 };
+};
+
+// Appends blocks to rolling segment file of one thread. Segment is switched
+// when it grows over the size limit or becomes older than the age limit
+// (age is checked when the next block arrives).
+// Every segment bulk_<ns>_<writer>.seg has index bulk_<ns>_<writer>.idx
+// that consists of fixed size records { block id; offset in segment },
+// both are 64-bit integers in host byte order.
+class SegmentWriter {
+public:
+    struct IndexRecord {
+        uint64_t block_id;
+        uint64_t offset;
+    };
+
+public:
+    SegmentWriter(const SegmentOptions& options, size_t writer_id);
+    ~SegmentWriter();
+
+    SegmentWriter(const SegmentWriter&) = delete;
+    SegmentWriter& operator= (const SegmentWriter&) = delete;
+
+    void write(const Block& block);
+    // segment and its index are completed, the next block opens new segment
+    void close();
+
+    size_t nsegments() const { return nsegments_; }
+
+private:
+    void open();
+    void flush_index();
+
+    const SegmentOptions& options_;
+    const size_t writer_id_;
+
+    int fd_ { -1 };
+    int index_fd_ { -1 };
+    uint64_t size_ { 0 };
+    std::chrono::steady_clock::time_point opened_;
+    std::vector<IndexRecord> index_;
+    size_t nsegments_ { 0 };
+};
+
+// File job writing blocks into rolling segments. Each thread running a copy
+// of the sink creates its own writer on the first block. Directory is
+// checked by constructor; it and failed writes throw std::system_error,
+// worker reports errors of writes by join.
+class SegmentSink {
+public:
+    explicit SegmentSink(SegmentOptions options);
+    SegmentSink(const SegmentSink& other);
+    ~SegmentSink();
+
+    void operator() (const Block& block);
+    // current segment is closed when worker is joined
+    void finish();
+
+private:
+    struct Shared {
+        SegmentOptions options;
+        std::atomic<size_t> nwriters { 0 };
+    };
+
+    std::shared_ptr<Shared> shared_;
+    std::unique_ptr<SegmentWriter> writer_;
+};
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,479 @@
+#include "server.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include <system_error>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "block.h"
+#include "histogram.h"
+#include "line_scanner.h"
+#include "reader_subscriber.h"
+#include "socket_address.h"
+
+namespace griha {
+
+namespace {
+
+constexpr size_t c_read_size = 64u << 10;
+constexpr int c_max_events = 256;
+// accepting is retried with this period when descriptors are exhausted
+constexpr int c_accept_retry_ms = 100;
+
+using Clock = std::chrono::steady_clock;
+
+[[noreturn]] void throw_error(int error, const std::string& what) {
+    throw std::system_error { error, std::generic_category(), what };
+}
+
+// stop event of the server run with stop on signals
+std::atomic<int> g_stop_fd { -1 };
+
+void on_stop_signal(int) {
+    const auto fd = g_stop_fd.load();
+    if (fd >= 0) {
+        const uint64_t one = 1;
+        [[maybe_unused]] auto n = write(fd, &one, sizeof(one));
+    }
+}
+
+// stops the server by SIGINT and SIGTERM while alive
+class StopSignals {
+public:
+    StopSignals(bool enabled, int stop_fd) : enabled_(enabled) {
+        if (!enabled_)
+            return;
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = on_stop_signal;
+        sigemptyset(&action.sa_mask);
+        g_stop_fd = stop_fd;
+        sigaction(SIGINT, &action, &old_int_);
+        sigaction(SIGTERM, &action, &old_term_);
+    }
+
+    ~StopSignals() {
+        if (!enabled_)
+            return;
+        sigaction(SIGINT, &old_int_, nullptr);
+        sigaction(SIGTERM, &old_term_, nullptr);
+        g_stop_fd = -1;
+    }
+
+    StopSignals(const StopSignals&) = delete;
+    StopSignals& operator= (const StopSignals&) = delete;
+
+private:
+    const bool enabled_;
+    struct sigaction old_int_;
+    struct sigaction old_term_;
+};
+
+struct Connection {
+    explicit Connection(int f) : fd(f) {}
+
+    const int fd;
+    std::string partial;    // the line isn't terminated yet
+    size_t level { 0 };     // of nested explicit blocks
+    BlockBuilder block;     // explicit block
+    Clock::time_point block_start;
+};
+
+} // unnamed namespace
+
+struct ServerImpl {
+    ServerImpl(const ServerOptions& opts, size_t bsize, std::chrono::milliseconds age);
+    ~ServerImpl();
+
+    const ServerOptions options;
+    const SocketAddress address;
+    const size_t block_size;
+    const Clock::duration max_age;
+
+    int listen_fd { -1 };
+    int epoll_fd { -1 };
+    int stop_fd { -1 };
+    bool accepting { true };
+
+    std::vector<ReaderSubscriberPtr> subscribers;
+
+    // connections are indexed by descriptor
+    std::vector<std::unique_ptr<Connection>> connections;
+    size_t nconnections { 0 };
+
+    // statements of all clients outside of explicit blocks
+    BlockBuilder shared;
+    size_t shared_count { 0 };
+    Clock::time_point shared_start;
+
+    RangeLines lines;
+    std::vector<char> buffer;
+
+    // ages are measured only if max age is set
+    Histogram block_ages;
+
+    Reader::Metrics metrics;
+    Server::Metrics server_metrics;
+
+    void run();
+    void release();
+    int timeout() const;
+
+    void watch(int fd);
+    void accept_clients();
+    void pause_accepting();
+    void resume_accepting();
+
+    // returns false if there is nothing to read now or connection is closed
+    bool read_client(Connection& client);
+    void close_client(Connection& client, bool eof);
+
+    // returns false if connection has to be closed
+    bool input(Connection& client, const char* begin, const char* end);
+    bool keep_partial(Connection& client, const char* begin, const char* end);
+    bool handle_line(Connection& client, std::string_view line, LineKind kind);
+
+    void flush_shared();
+    void notify_block(BlockBuilder& builder, Clock::time_point start);
+    void notify_unexpected_eof(BlockBuilder& builder);
+};
+
+ServerImpl::ServerImpl(const ServerOptions& opts, size_t bsize, std::chrono::milliseconds age)
+    : options(opts)
+    , address(parse_socket_address(opts.address))
+    , block_size(bsize)
+    , max_age(age)
+    , buffer(c_read_size) {
+    try {
+        listen_fd = listen_socket(address, options.backlog);
+
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0)
+            throw_error(errno, "can't create epoll");
+
+        stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (stop_fd < 0)
+            throw_error(errno, "can't create eventfd");
+
+        watch(listen_fd);
+        watch(stop_fd);
+    } catch (...) {
+        release();
+        throw;
+    }
+}
+
+ServerImpl::~ServerImpl() {
+    release();
+}
+
+void ServerImpl::release() {
+    // socket file is removed only if it has been created by the server
+    if (listen_fd >= 0 && !address.unix_path.empty())
+        unlink(address.unix_path.c_str());
+
+    for (auto fd : { stop_fd, epoll_fd, listen_fd })
+        if (fd >= 0)
+            close(fd);
+    stop_fd = epoll_fd = listen_fd = -1;
+
+    for (auto& client : connections)
+        if (client)
+            close(client->fd);
+    connections.clear();
+}
+
+void ServerImpl::watch(int fd) {
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+        throw_error(errno, "can't watch descriptor");
+}
+
+void ServerImpl::run() {
+    metrics = {};
+    server_metrics = {};
+    shared.clear();
+    const auto nallocations = shared.nallocations();
+
+    epoll_event events[c_max_events];
+    bool stopping = false;
+    while (!stopping) {
+        const auto n = epoll_wait(epoll_fd, events, c_max_events, timeout());
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw_error(errno, "can't wait for events");
+        }
+
+        for (auto i = 0; i < n; ++i) {
+            const auto fd = events[i].data.fd;
+            if (fd == listen_fd) {
+                accept_clients();
+            } else if (fd == stop_fd) {
+                stopping = true;
+            } else if (static_cast<size_t>(fd) < connections.size() && connections[fd]) {
+                // descriptor may be closed by previous events
+                read_client(*connections[fd]);
+            }
+        }
+
+        if (max_age != Clock::duration::zero() && shared_count != 0
+                && Clock::now() - shared_start >= max_age) {
+            // shared block is too old to wait for next statements
+            ++metrics.nexpired;
+            flush_shared();
+        }
+
+        if (!accepting)
+            resume_accepting();
+    }
+
+    // input sent before stopping is handled, then it's the end of input of all clients
+    if (accepting)
+        accept_clients();
+    for (auto& client : connections) {
+        while (client && read_client(*client)) {
+            // do nothing
+        }
+        if (client)
+            close_client(*client, true);
+    }
+    flush_shared();
+
+    uint64_t value;
+    [[maybe_unused]] auto nread = read(stop_fd, &value, sizeof(value));
+
+    metrics.nallocations += shared.nallocations() - nallocations;
+    using std::chrono::microseconds;
+    metrics.block_age.p50 = microseconds(block_ages.percentile(50));
+    metrics.block_age.p90 = microseconds(block_ages.percentile(90));
+    metrics.block_age.p99 = microseconds(block_ages.percentile(99));
+    metrics.block_age.max = microseconds(block_ages.max());
+    block_ages.clear();
+}
+
+int ServerImpl::timeout() const {
+    using namespace std::chrono;
+
+    int result = -1;
+    if (max_age != Clock::duration::zero() && shared_count != 0) {
+        const auto left = ceil<milliseconds>(shared_start + max_age - Clock::now());
+        result = static_cast<int>(std::max<milliseconds::rep>(left.count(), 0));
+    }
+    if (!accepting)
+        result = result < 0 ? c_accept_retry_ms : std::min(result, c_accept_retry_ms);
+    return result;
+}
+
+void ServerImpl::accept_clients() {
+    while (true) {
+        const auto fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+                pause_accepting(); // pending connections wait in backlog
+            return;
+        }
+
+        try {
+            if (static_cast<size_t>(fd) >= connections.size())
+                connections.resize(static_cast<size_t>(fd) + 1);
+            connections[fd] = std::make_unique<Connection>(fd);
+            watch(fd);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            connections[fd].reset();
+            close(fd);
+            continue;
+        }
+
+        ++server_metrics.naccepted;
+        server_metrics.max_clients = std::max(server_metrics.max_clients, ++nconnections);
+    }
+}
+
+void ServerImpl::pause_accepting() {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, listen_fd, nullptr);
+    accepting = false;
+}
+
+void ServerImpl::resume_accepting() {
+    watch(listen_fd);
+    accepting = true;
+}
+
+bool ServerImpl::read_client(Connection& client) {
+    const auto n = read(client.fd, buffer.data(), buffer.size());
+    if (n < 0 && errno == EINTR)
+        return true;
+    if (n < 0 && errno == EAGAIN)
+        return false;
+    if (n <= 0) {
+        // read error is treated as end of input as well
+        close_client(client, true);
+        return false;
+    }
+
+    ++metrics.nchunks;
+    if (!input(client, buffer.data(), buffer.data() + n)) {
+        ++server_metrics.nrejected;
+        close_client(client, false);
+        return false;
+    }
+    return true;
+}
+
+void ServerImpl::close_client(Connection& client, bool eof) {
+    if (eof) {
+        // the last line isn't terminated by new line symbol
+        if (!client.partial.empty())
+            handle_line(client, client.partial, classify_line(client.partial));
+        if (client.level != 0)
+            notify_unexpected_eof(client.block);
+    }
+
+    metrics.nallocations += client.block.nallocations();
+
+    const auto fd = client.fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections[fd].reset();
+    --nconnections;
+}
+
+bool ServerImpl::input(Connection& client, const char* begin, const char* end) {
+    if (!client.partial.empty()) {
+        const auto nl = static_cast<const char*>(std::memchr(begin, '\n', static_cast<size_t>(end - begin)));
+        if (nl == nullptr)
+            return keep_partial(client, begin, end);
+        client.partial.append(begin, nl);
+        if (!handle_line(client, client.partial, classify_line(client.partial)))
+            return false;
+        client.partial.clear();
+        begin = nl + 1;
+    }
+
+    const auto last = static_cast<const char*>(memrchr(begin, '\n', static_cast<size_t>(end - begin)));
+    const auto lines_end = last != nullptr ? last + 1 : begin;
+    lines.reset(begin, lines_end);
+
+    std::string_view line;
+    LineKind kind;
+    while (lines.next_line(line, kind))
+        if (!handle_line(client, line, kind))
+            return false;
+
+    client.partial.clear();
+    return keep_partial(client, lines_end, end);
+}
+
+// client sending no new line symbols mustn't exhaust memory
+bool ServerImpl::keep_partial(Connection& client, const char* begin, const char* end) {
+    if (client.partial.size() + static_cast<size_t>(end - begin) > options.max_line) {
+        std::cerr << "line is too long" << std::endl;
+        return false;
+    }
+    client.partial.append(begin, end);
+    return true;
+}
+
+bool ServerImpl::handle_line(Connection& client, std::string_view line, LineKind kind) {
+    ++metrics.nlines;
+
+    const auto timed = max_age != Clock::duration::zero();
+    if (kind == LineKind::block_begin) {
+        // nested explicit blocks are ignored but correction of syntax is required
+        ++client.level;
+    } else if (kind == LineKind::block_end) {
+        if (client.level == 0) {
+            std::cerr << "unexpected end of block" << std::endl;
+            return false;
+        }
+        if (--client.level == 0)
+            notify_block(client.block, client.block_start);
+    } else if (client.level != 0) {
+        ++metrics.nstatements;
+        if (timed && client.block.empty())
+            client.block_start = Clock::now();
+        client.block.append(line, nullptr);
+    } else {
+        ++metrics.nstatements;
+        if (timed && shared.empty())
+            shared_start = Clock::now();
+        shared.append(line, nullptr);
+        if (++shared_count == block_size)
+            flush_shared();
+    }
+    return true;
+}
+
+void ServerImpl::flush_shared() {
+    notify_block(shared, shared_start);
+    shared_count = 0;
+}
+
+void ServerImpl::notify_block(BlockBuilder& builder, Clock::time_point start) {
+    if (builder.empty())
+        return; // empty block doesn't require notification
+
+    ++metrics.nblocks;
+    if (max_age != Clock::duration::zero()) {
+        const auto age = Clock::now() - start;
+        block_ages.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(age).count()));
+    }
+
+    const auto block = builder.build(metrics.nblocks);
+    for (auto& subscriber : subscribers)
+        subscriber->on_block(block);
+}
+
+void ServerImpl::notify_unexpected_eof(BlockBuilder& builder) {
+    if (builder.empty())
+        return; // empty block doesn't require notification
+
+    const auto block = builder.build(metrics.nblocks + 1);
+    for (auto& subscriber : subscribers)
+        subscriber->on_unexpected_eof(block);
+}
+
+Server::Server(const ServerOptions& options, size_t block_size, std::chrono::milliseconds max_age)
+    : priv_(std::make_unique<ServerImpl>(options, block_size, max_age)) {}
+
+Server::~Server() = default;
+
+void Server::subscribe(ReaderSubscriberPtr subscriber) {
+    auto& subscribers = priv_->subscribers;
+    auto it = std::find(subscribers.begin(), subscribers.end(), subscriber);
+    if (it == subscribers.end())
+        subscribers.push_back(std::move(subscriber));
+}
+
+auto Server::run() -> const Reader::Metrics& {
+    StopSignals signals { priv_->options.stop_on_signals, priv_->stop_fd };
+    priv_->run();
+    return priv_->metrics;
+}
+
+void Server::stop() {
+    const uint64_t one = 1;
+    [[maybe_unused]] auto n = write(priv_->stop_fd, &one, sizeof(one));
+}
+
+auto Server::server_metrics() const -> const Metrics& {
+    return priv_->server_metrics;
+}
+
+} // namespace griha
\ No newline at end of file
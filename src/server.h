@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "forward.h"
+#include "reader.h"
+
+namespace griha {
+
+constexpr size_t c_default_max_line = 4u << 20;
+
+struct ServerOptions {
+    std::string address;            // "unix:<path>" or "<host>:<port>"
+    int backlog { 1024 };
+    bool stop_on_signals { false }; // SIGINT and SIGTERM stop the server
+    size_t max_line { c_default_max_line }; // longer line closes the connection
+};
+
+// Reads statements of many clients by single epoll loop.
+// Statements outside of explicit blocks of all clients are collected into
+// one shared dynamic block; explicit blocks are built for every client
+// separately and don't end the shared block. Closed connection ends its
+// explicit block as end of file does; "}" outside of explicit block closes
+// the connection, so does a line longer than max line. The shared block is
+// flushed by its size, by max age and when the server stops.
+class Server {
+public:
+    struct Metrics {
+        size_t naccepted;
+        size_t max_clients;     // connected at once
+        size_t nrejected;       // connections closed because of syntax error or too long line
+    };
+
+public:
+    // throws std::system_error or std::invalid_argument if address can't be listened
+    Server(const ServerOptions& options, size_t block_size,
+           std::chrono::milliseconds max_age = {});
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator= (const Server&) = delete;
+
+    void subscribe(ReaderSubscriberPtr subscriber);
+
+    // serves clients until stop is called
+    const Reader::Metrics& run();
+    // may be called from any thread and from signal handler
+    void stop();
+
+    const Metrics& server_metrics() const;
+
+private:
+    std::unique_ptr<struct ServerImpl> priv_;
+};
+
+} // namespace griha
\ No newline at end of file
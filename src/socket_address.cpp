@@ -0,0 +1,106 @@
+#include "socket_address.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace griha {
+
+namespace {
+
+constexpr auto c_unix_prefix = "unix:";
+
+[[noreturn]] void throw_error(int error, const std::string& what) {
+    throw std::system_error { error, std::generic_category(), what };
+}
+
+} // unnamed namespace
+
+SocketAddress parse_socket_address(const std::string& address) {
+    SocketAddress result;
+    std::memset(&result.storage, 0, sizeof(result.storage));
+
+    const auto prefix_size = std::strlen(c_unix_prefix);
+    if (address.compare(0, prefix_size, c_unix_prefix) == 0) {
+        result.unix_path = address.substr(prefix_size);
+        auto& un = reinterpret_cast<sockaddr_un&>(result.storage);
+        if (result.unix_path.empty() || result.unix_path.size() >= sizeof(un.sun_path))
+            throw std::invalid_argument { "bad unix socket path: " + address };
+        un.sun_family = AF_UNIX;
+        std::memcpy(un.sun_path, result.unix_path.c_str(), result.unix_path.size() + 1);
+        result.length = static_cast<socklen_t>(sizeof(sa_family_t) + result.unix_path.size() + 1);
+        return result;
+    }
+
+    const auto colon = address.rfind(':');
+    if (colon == std::string::npos || colon + 1 == address.size())
+        throw std::invalid_argument { "address has to be unix:<path> or <host>:<port>: " + address };
+    auto host = address.substr(0, colon);
+    const auto port = address.substr(colon + 1);
+    if (host.size() > 1 && host.front() == '[' && host.back() == ']')
+        host = host.substr(1, host.size() - 2);
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* info = nullptr;
+    const auto error = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &info);
+    if (error != 0)
+        throw std::invalid_argument { "can't resolve " + address + ": " + gai_strerror(error) };
+
+    std::memcpy(&result.storage, info->ai_addr, info->ai_addrlen);
+    result.length = info->ai_addrlen;
+    freeaddrinfo(info);
+    return result;
+}
+
+int listen_socket(const SocketAddress& address, int backlog) {
+    const auto fd = socket(address.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        throw_error(errno, "can't create socket");
+
+    if (address.family() == AF_UNIX) {
+        struct stat st;
+        if (stat(address.unix_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+            unlink(address.unix_path.c_str());
+    } else {
+        const int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    }
+
+    if (bind(fd, address.get(), address.length) != 0 || listen(fd, backlog) != 0) {
+        const auto error = errno;
+        close(fd);
+        throw_error(error, "can't listen socket");
+    }
+    return fd;
+}
+
+int connect_socket(const SocketAddress& address) {
+    const auto fd = socket(address.family(), SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        throw_error(errno, "can't create socket");
+
+    if (connect(fd, address.get(), address.length) != 0) {
+        const auto error = errno;
+        close(fd);
+        throw_error(error, "can't connect socket");
+    }
+    if (address.family() != AF_UNIX) {
+        const int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    return fd;
+}
+
+} // namespace griha
\ No newline at end of file
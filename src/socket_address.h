@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+#include <sys/socket.h>
+
+namespace griha {
+
+// Local socket address given as "unix:<path>" or "<host>:<port>"
+struct SocketAddress {
+    sockaddr_storage storage;
+    socklen_t length;
+    std::string unix_path;  // empty for TCP
+
+    const sockaddr* get() const { return reinterpret_cast<const sockaddr*>(&storage); }
+    int family() const { return storage.ss_family; }
+};
+
+// throws std::invalid_argument if address can't be parsed or resolved
+SocketAddress parse_socket_address(const std::string& address);
+
+// non-blocking listening socket; stale unix socket file is replaced;
+// throws std::system_error
+int listen_socket(const SocketAddress& address, int backlog);
+// blocking connected socket; throws std::system_error
+int connect_socket(const SocketAddress& address);
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "spill_file.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "block.h"
+
+namespace griha {
+
+SpillFile::SpillFile(const std::string& dir) {
+    auto path = dir + "/bulkmt_spill_XXXXXX";
+    fd_ = mkstemp(&path[0]);
+    if (fd_ < 0)
+        throw std::system_error { errno, std::generic_category(), "can't create spill file in " + dir };
+    // file is removed by the system when descriptor is closed
+    unlink(path.c_str());
+}
+
+SpillFile::~SpillFile() {
+    close(fd_);
+}
+
+void SpillFile::write(const void* data, size_t size) {
+    auto p = static_cast<const char*>(data);
+    while (size != 0) {
+        auto n = pwrite(fd_, p, size, write_pos_);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            throw std::system_error { errno, std::generic_category(), "can't write spill file" };
+        p += n;
+        size -= static_cast<size_t>(n);
+        write_pos_ += n;
+    }
+}
+
+void SpillFile::read(void* data, size_t size) {
+    auto p = static_cast<char*>(data);
+    while (size != 0) {
+        auto n = pread(fd_, p, size, read_pos_);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            throw std::system_error { n == 0 ? EIO : errno, std::generic_category(), "can't read spill file" };
+        p += n;
+        size -= static_cast<size_t>(n);
+        read_pos_ += n;
+    }
+}
+
+void SpillFile::push(const Block& block) {
+    // record is id, number of statements, size of bytes and times of block
+    // followed by bytes of block
+    const auto bytes = block.bytes();
+    const uint64_t header[] = {
+        block.id(), block.size(), bytes.size(),
+        static_cast<uint64_t>(block.created().time_since_epoch().count()),
+        static_cast<uint64_t>(block.published().time_since_epoch().count())
+    };
+    write(header, sizeof(header));
+    write(bytes.data(), bytes.size());
+    ++size_;
+}
+
+const BlockPtr& SpillFile::front() {
+    if (front_ || empty())
+        return front_;
+
+    uint64_t header[5];
+    read(header, sizeof(header));
+    std::vector<char> bytes(header[2]);
+    read(bytes.data(), bytes.size());
+
+    // every value is terminated by new line symbol
+    BlockBuilder builder;
+    const char* begin = bytes.data();
+    const auto bytes_end = bytes.data() + bytes.size();
+    for (auto i = 0u; i < header[1]; ++i) {
+        auto end = static_cast<const char*>(std::memchr(begin, '\n', static_cast<size_t>(bytes_end - begin)));
+        builder.append({ begin, static_cast<size_t>(end - begin) }, nullptr);
+        begin = end + 1;
+    }
+
+    using Duration = Block::TimePoint::duration;
+    front_ = builder.build(header[0],
+        Block::TimePoint { Duration { static_cast<Duration::rep>(header[3]) } },
+        Block::TimePoint { Duration { static_cast<Duration::rep>(header[4]) } });
+    return front_;
+}
+
+void SpillFile::pop() {
+    front();
+    front_.reset();
+    if (--size_ == 0) {
+        // all blocks have been read back - reuse the file from the beginning
+        if (ftruncate(fd_, 0) != 0)
+            throw std::system_error { errno, std::generic_category(), "can't truncate spill file" };
+        write_pos_ = read_pos_ = 0;
+    }
+}
+
+} // namespace griha
\ No newline at end of file
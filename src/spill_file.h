@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <sys/types.h>
+
+#include "forward.h"
+
+namespace griha {
+
+// FIFO of blocks stored in unlinked temporary file. Blocks are appended
+// to the end of the file and are read back from the beginning. The file is
+// truncated every time it becomes empty.
+class SpillFile {
+public:
+    explicit SpillFile(const std::string& dir);
+    ~SpillFile();
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator= (const SpillFile&) = delete;
+
+    void push(const Block& block);
+
+    // the oldest block; it remains in the file until pop is called
+    const BlockPtr& front();
+    void pop();
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    void write(const void* data, size_t size);
+    void read(void* data, size_t size);
+
+    int fd_;
+    off_t write_pos_ { 0 };
+    off_t read_pos_ { 0 };
+    size_t size_ { 0 };
+    BlockPtr front_;
+};
+
+} // namespace griha
\ No newline at end of file
@@ -1,9 +1,22 @@
 #include "statement.h"
 
+#include "block.h"
+
 namespace griha {
 
 void SomeStatement::execute(Executer& ex_ctx) {
     ex_ctx.execute(*this);
 }
 
+void Executer::execute(const Block& block) {
+    visit_batches(block, [this] (const auto& batch) { execute(batch); });
+}
+
+void Executer::execute(const StatementBatch<SomeStatement>& batch) {
+    for (auto value : batch) {
+        SomeStatement stm { value, nullptr };
+        execute(stm);
+    }
+}
+
 } // namespace griha
\ No newline at end of file
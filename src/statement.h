@@ -1,7 +1,11 @@
- #pragma once
+#pragma once
 
+#include <cstddef>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
+#include "block.h"
 #include "forward.h"
 
 namespace griha {
@@ -15,18 +19,99 @@ struct Statement {
 class SomeStatement : public Statement {
 
 public:
-    explicit SomeStatement(std::string value) : value_(std::move(value)) {}
+    explicit SomeStatement(std::string value) 
+        : storage_(std::move(value))
+        , value_(storage_) {}
+
+    // statement refers to the piece of input chunk and keeps it alive
+    SomeStatement(std::string_view value, InputChunkPtr chunk)
+        : chunk_(std::move(chunk))
+        , value_(value) {}
+
+    SomeStatement(const SomeStatement&) = delete;
+    SomeStatement& operator= (const SomeStatement&) = delete;
 
     void execute(Executer& ex_ctx) override;
 
-    const std::string& value() const { return value_; }
+    std::string_view value() const { return value_; }
 
 private:
-    std::string value_;
+    std::string storage_;
+    InputChunkPtr chunk_;
+    std::string_view value_;
 };
 
+// kinds of statements known at compile time, visitors of batches have to
+// handle all of them
+template <typename... Kinds>
+struct StatementKinds {};
+
+using AllStatementKinds = StatementKinds<SomeStatement>;
+
+// Run of consecutive statements of one kind of the block. Values are stored
+// contiguously, each is followed by new line symbol, so the run can be
+// formatted in one pass over its bytes.
+template <typename Kind>
+class StatementBatch {
+public:
+    using kind = Kind;
+    using const_iterator = Block::const_iterator;
+
+public:
+    StatementBatch(const Block& block, size_t first, size_t last)
+        : block_(&block), first_(first), last_(last) {}
+
+    size_t size() const { return last_ - first_; }
+    bool empty() const { return first_ == last_; }
+
+    std::string_view operator[] (size_t i) const { return (*block_)[first_ + i]; }
+
+    // values of the run, each is terminated by new line symbol
+    std::string_view bytes() const {
+        if (empty())
+            return {};
+        const auto first = (*block_)[first_];
+        const auto last = (*block_)[last_ - 1];
+        return { first.data(), static_cast<size_t>(last.data() + last.size() + 1 - first.data()) };
+    }
+
+    const_iterator begin() const { return { block_, first_ }; }
+    const_iterator end() const { return { block_, last_ }; }
+
+private:
+    const Block* block_;
+    size_t first_;
+    size_t last_;
+};
+
+namespace detail {
+
+template <typename Visitor, typename... Kinds>
+constexpr bool visits_all(StatementKinds<Kinds...>) {
+    return (std::is_invocable_v<Visitor&, const StatementBatch<Kinds>&> && ...);
+}
+
+} // namespace detail
+
+// Calls visitor for every run of statements of the block like std::visit,
+// the kind of run is resolved at compile time, so visitor is inlined into
+// the loop over the block. Every line is SomeStatement so far, hence block
+// is one run; empty block has no runs.
+template <typename Visitor>
+void visit_batches(const Block& block, Visitor&& visitor) {
+    static_assert(detail::visits_all<Visitor>(AllStatementKinds {}),
+                  "visitor doesn't handle all kinds of statements");
+    if (!block.empty())
+        visitor(StatementBatch<SomeStatement> { block, 0, block.size() });
+}
+
 struct Executer {
     virtual void execute(const SomeStatement&) = 0;
+    // runs of block are passed to batch overloads, one virtual call per run
+    virtual void execute(const Block&);
+    // default implementation visits statements one by one, executers are
+    // supposed to override it to process whole run without per-statement dispatch
+    virtual void execute(const StatementBatch<SomeStatement>&);
 };
 
 
@@ -8,4 +8,8 @@ StatementPtr StatementFactory::create(std::string line) const {
     return std::make_shared<SomeStatement>(std::move(line));
 }
 
+StatementPtr StatementFactory::create(std::string_view line, InputChunkPtr chunk) const {
+    return std::make_shared<SomeStatement>(line, std::move(chunk));
+}
+
 } // namespace griha
\ No newline at end of file
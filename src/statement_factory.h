@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 
 #include "forward.h"
 
@@ -8,6 +9,7 @@ namespace griha {
 
 struct StatementFactory {
     StatementPtr create(std::string) const;
+    StatementPtr create(std::string_view, InputChunkPtr) const;
 };
 
 } // namespace griha
\ No newline at end of file
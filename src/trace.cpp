@@ -0,0 +1,237 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace griha {
+namespace trace {
+
+namespace {
+
+struct Event {
+    const char* category;
+    const char* name;
+    uint64_t begin_ns;
+    uint64_t end_ns;
+    char phase;     // 'X' - span, 'i' - instant
+};
+
+// written by its thread only; events below size are complete
+struct ThreadBuffer {
+    std::unique_ptr<Event[]> events { new Event[c_thread_capacity] };
+    std::atomic<size_t> size { 0 };
+    std::atomic<size_t> ndropped { 0 };
+    std::atomic<const char*> name { nullptr };
+    long tid { syscall(SYS_gettid) };
+};
+
+struct Tracer {
+    std::mutex guard;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    // buffers of previous generation have been discarded by reset
+    std::atomic<uint64_t> generation { 1 };
+    std::atomic<bool> enabled { false };
+    uint64_t start_ns { 0 };
+
+    std::string path;
+    int signal { 0 };
+    struct sigaction old_action {};
+    std::atomic<bool> stopping { false };
+    std::thread dumper;
+};
+
+Tracer& tracer() {
+    static Tracer t;
+    return t;
+}
+
+// eventfd waking up the dumper; it's written by the signal handler
+std::atomic<int> g_wakeup_fd { -1 };
+
+void on_signal(int) {
+    const auto saved_errno = errno;
+    const uint64_t one = 1;
+    if (write(g_wakeup_fd.load(), &one, sizeof(one)) < 0) {
+        // dumper is woken up already
+    }
+    errno = saved_errno;
+}
+
+ThreadBuffer& thread_buffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    thread_local uint64_t generation = 0;
+
+    auto& t = tracer();
+    const auto current = t.generation.load(std::memory_order_acquire);
+    if (buffer == nullptr || generation != current) {
+        std::lock_guard<std::mutex> l { t.guard };
+        t.buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = t.buffers.back().get();
+        generation = current;
+    }
+    return *buffer;
+}
+
+void record(const Event& event) {
+    auto& buffer = thread_buffer();
+    const auto size = buffer.size.load(std::memory_order_relaxed);
+    if (size == c_thread_capacity) {
+        buffer.ndropped.store(buffer.ndropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events[size] = event;
+    // event is visible to the dumper since size is published
+    buffer.size.store(size + 1, std::memory_order_release);
+}
+
+void write_file(const std::string& path) {
+    // readers of the file never see it partially written
+    const auto tmp = path + ".tmp";
+    {
+        std::ofstream output { tmp };
+        dump(output);
+    }
+    std::rename(tmp.c_str(), path.c_str());
+}
+
+void dumper() {
+    auto& t = tracer();
+    uint64_t value;
+    while (read(g_wakeup_fd.load(), &value, sizeof(value)) > 0 || errno == EINTR) {
+        if (t.stopping.load())
+            return;
+        write_file(t.path);
+    }
+}
+
+} // unnamed namespace
+
+void start(const std::string& path, int signal) {
+    auto& t = tracer();
+    t.path = path;
+    t.start_ns = now_ns();
+
+    const auto fd = eventfd(0, EFD_CLOEXEC);
+    if (fd < 0)
+        throw std::system_error { errno, std::generic_category(), "can't create eventfd" };
+    g_wakeup_fd.store(fd);
+    t.stopping = false;
+    t.dumper = std::thread { dumper };
+
+    t.signal = signal;
+    if (signal != 0) {
+        struct sigaction action {};
+        action.sa_handler = on_signal;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        sigaction(signal, &action, &t.old_action);
+    }
+    t.enabled.store(true, std::memory_order_release);
+}
+
+void stop() {
+    auto& t = tracer();
+    if (!t.dumper.joinable())
+        return;
+
+    t.enabled.store(false, std::memory_order_release);
+    if (t.signal != 0)
+        sigaction(t.signal, &t.old_action, nullptr);
+
+    t.stopping = true;
+    const uint64_t one = 1;
+    if (write(g_wakeup_fd.load(), &one, sizeof(one)) < 0) {
+        // eventfd counter can't overflow by one write
+    }
+    t.dumper.join();
+    close(g_wakeup_fd.exchange(-1));
+
+    write_file(t.path);
+}
+
+bool enabled() {
+    return tracer().enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void complete(const char* category, const char* name, uint64_t begin_ns, uint64_t end_ns) {
+    record({ category, name, begin_ns, end_ns, 'X' });
+}
+
+void instant(const char* category, const char* name) {
+    if (!enabled())
+        return;
+    const auto now = now_ns();
+    record({ category, name, now, now, 'i' });
+}
+
+void name_thread(const char* name) {
+    if (!enabled())
+        return;
+    thread_buffer().name.store(name, std::memory_order_relaxed);
+}
+
+void dump(std::ostream& os) {
+    auto& t = tracer();
+    const auto pid = getpid();
+    // timestamps are microseconds since start
+    const auto us = [&t] (uint64_t ns) { return static_cast<double>(ns - std::min(ns, t.start_ns)) / 1000; };
+
+    std::lock_guard<std::mutex> l { t.guard };
+    size_t ndropped = 0;
+    auto sep = "\n";
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    os.setf(std::ios::fixed);
+    os.precision(3);
+    for (auto& buffer : t.buffers) {
+        if (auto name = buffer->name.load(std::memory_order_relaxed)) {
+            os << sep << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid
+               << ",\"tid\":" << buffer->tid << ",\"args\":{\"name\":\"" << name << "\"}}";
+            sep = ",\n";
+        }
+
+        const auto size = buffer->size.load(std::memory_order_acquire);
+        for (size_t i = 0; i < size; ++i) {
+            const auto& e = buffer->events[i];
+            os << sep << "{\"ph\":\"" << e.phase << "\",\"cat\":\"" << e.category
+               << "\",\"name\":\"" << e.name << "\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+               << ",\"ts\":" << us(e.begin_ns);
+            if (e.phase == 'X')
+                os << ",\"dur\":" << static_cast<double>(e.end_ns - e.begin_ns) / 1000;
+            else
+                os << ",\"s\":\"t\"";
+            os << '}';
+            sep = ",\n";
+        }
+        ndropped += buffer->ndropped.load(std::memory_order_relaxed);
+    }
+    os << "\n],\"otherData\":{\"dropped\":" << ndropped << "}}\n";
+}
+
+void reset() {
+    auto& t = tracer();
+    std::lock_guard<std::mutex> l { t.guard };
+    t.buffers.clear();
+    t.generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+} // namespace trace
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Tracing spans are compiled in with BULKMT_TRACE defined, otherwise the
+// macros expand to nothing. Names and categories have to be string literals.
+//
+//   BULKMT_TRACE_SPAN("reader", "batch");     // lasts till the end of scope
+//   BULKMT_TRACE_INSTANT("reader", "error");
+//   BULKMT_TRACE_THREAD("reader");            // name of the thread in trace
+#ifdef BULKMT_TRACE
+#define BULKMT_TRACE_CONCAT_(a, b) a##b
+#define BULKMT_TRACE_CONCAT(a, b) BULKMT_TRACE_CONCAT_(a, b)
+#define BULKMT_TRACE_SPAN(category, name) \
+    ::griha::trace::Span BULKMT_TRACE_CONCAT(trace_span_, __LINE__) { category, name }
+#define BULKMT_TRACE_INSTANT(category, name) ::griha::trace::instant(category, name)
+#define BULKMT_TRACE_THREAD(name) ::griha::trace::name_thread(name)
+#else
+#define BULKMT_TRACE_SPAN(category, name) ((void)0)
+#define BULKMT_TRACE_INSTANT(category, name) ((void)0)
+#define BULKMT_TRACE_THREAD(name) ((void)0)
+#endif
+
+namespace griha {
+namespace trace {
+
+#ifdef BULKMT_TRACE
+constexpr bool c_compiled = true;
+#else
+constexpr bool c_compiled = false;
+#endif
+
+// Every thread records events into its own buffer without locks. The buffer
+// has fixed capacity, events recorded after it's full are counted as dropped.
+constexpr size_t c_thread_capacity = 1u << 16; // events
+
+// Events are recorded after start only. Buffers are dumped into the file as
+// Chrome trace JSON (chrome://tracing, ui.perfetto.dev) by stop and when
+// the process gets the signal; 0 - no signal. Throws std::system_error.
+void start(const std::string& path, int signal);
+void stop();
+
+bool enabled();
+uint64_t now_ns();
+
+// span from begin to end, it's shown as nested if it's inside other span
+void complete(const char* category, const char* name, uint64_t begin_ns, uint64_t end_ns);
+void instant(const char* category, const char* name);
+void name_thread(const char* name);
+
+// all events recorded so far
+void dump(std::ostream& os);
+// events and thread buffers are discarded; recording threads must be done
+void reset();
+
+class Span {
+public:
+    Span(const char* category, const char* name)
+        : category_(category), name_(name), begin_ns_(enabled() ? now_ns() : 0) {}
+
+    ~Span() {
+        if (begin_ns_ != 0)
+            complete(category_, name_, begin_ns_, now_ns());
+    }
+
+    Span(const Span&) = delete;
+    Span& operator= (const Span&) = delete;
+
+private:
+    const char* category_;
+    const char* name_;
+    uint64_t begin_ns_;
+};
+
+} // namespace trace
+} // namespace griha
\ No newline at end of file
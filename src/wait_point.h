@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+namespace griha {
+
+constexpr size_t c_cache_line_size = 64;
+constexpr size_t c_spin_count = 256;
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Spin-then-park waiting. A waiter spins for a while checking the condition
+// and then falls asleep. Notification is cheap when nobody sleeps: it costs
+// one fence and one atomic load without taking the lock.
+class WaitPoint {
+public:
+    template <typename Ready>
+    void wait(Ready&& ready) {
+        // spinning makes no sense if there is no other core to change the state
+        static const auto spin_count = std::thread::hardware_concurrency() > 1 ? c_spin_count : 0u;
+
+        for (auto i = 0u; i < spin_count; ++i) {
+            if (ready())
+                return;
+            cpu_relax();
+        }
+
+        std::unique_lock<std::mutex> l { guard_ };
+        nwaiters_.fetch_add(1, std::memory_order_relaxed);
+        // pairs with the fence of notify: either notifier sees the waiter
+        // or the waiter sees the state published before notification
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cv_.wait(l, ready);
+        nwaiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void notify_one() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (nwaiters_.load(std::memory_order_relaxed) == 0)
+            return;
+        {
+            std::lock_guard<std::mutex> l { guard_ };
+        }
+        cv_.notify_one();
+    }
+
+    void notify_all() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (nwaiters_.load(std::memory_order_relaxed) == 0)
+            return;
+        {
+            std::lock_guard<std::mutex> l { guard_ };
+        }
+        cv_.notify_all();
+    }
+
+private:
+    std::mutex guard_;
+    std::condition_variable cv_;
+    std::atomic<size_t> nwaiters_ { 0 };
+};
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "work_stealing_queue.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace griha {
+
+WorkStealingQueue::WorkStealingQueue(size_t nthreads, size_t capacity)
+    : nthreads_(std::max<size_t>(nthreads, 1u))
+    , capacity_(std::max<size_t>(capacity, 1u))
+    , locals_(new Local[nthreads_]) {}
+
+void WorkStealingQueue::push(BlockPtr block) {
+    not_full_.wait([this] {
+        return size_.load(std::memory_order_relaxed) < capacity_
+            || closed_.load(std::memory_order_relaxed);
+    });
+    put(block);
+}
+
+bool WorkStealingQueue::try_push(BlockPtr& block) {
+    if (size_.load(std::memory_order_relaxed) >= capacity_)
+        return false;
+    put(block);
+    return true;
+}
+
+void WorkStealingQueue::put(BlockPtr& block) {
+    auto& local = locals_[next_];
+    next_ = (next_ + 1) % nthreads_;
+    {
+        std::lock_guard<std::mutex> l { local.guard };
+        local.blocks.push_back({ next_seq_++, std::move(block) });
+    }
+    size_.fetch_add(1, std::memory_order_release);
+    not_empty_.notify_one();
+}
+
+bool WorkStealingQueue::take(size_t thread_index, BlockPtr& block, bool& stolen) {
+    {
+        auto& local = locals_[thread_index];
+        std::lock_guard<std::mutex> l { local.guard };
+        if (!local.blocks.empty()) {
+            block = std::move(local.blocks.front().block);
+            local.blocks.pop_front();
+            stolen = false;
+            return true;
+        }
+    }
+
+    for (auto i = 1u; i < nthreads_; ++i) {
+        auto& victim = locals_[(thread_index + i) % nthreads_];
+        std::unique_lock<std::mutex> l { victim.guard, std::try_to_lock };
+        if (!l.owns_lock() || victim.blocks.empty())
+            continue;
+        // owner works from the front, thief takes from the back
+        block = std::move(victim.blocks.back().block);
+        victim.blocks.pop_back();
+        stolen = true;
+        return true;
+    }
+
+    return false;
+}
+
+bool WorkStealingQueue::try_pop(size_t thread_index, BlockPtr& block, bool& stolen) {
+    if (!take(thread_index, block, stolen))
+        return false;
+
+    size_.fetch_sub(1, std::memory_order_release);
+    not_full_.notify_one();
+    return true;
+}
+
+bool WorkStealingQueue::try_pop_oldest(BlockPtr& block) {
+    // fronts are compared while all deques are locked; consumers lock one
+    // deque at once or try to lock, so locking all in order can't deadlock
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(nthreads_);
+    Local* oldest = nullptr;
+    for (auto i = 0u; i < nthreads_; ++i) {
+        auto& local = locals_[i];
+        locks.emplace_back(local.guard);
+        if (!local.blocks.empty()
+                && (oldest == nullptr || local.blocks.front().seq < oldest->blocks.front().seq))
+            oldest = &local;
+    }
+    if (oldest == nullptr)
+        return false;
+
+    block = std::move(oldest->blocks.front().block);
+    oldest->blocks.pop_front();
+    locks.clear();
+
+    size_.fetch_sub(1, std::memory_order_release);
+    not_full_.notify_one();
+    return true;
+}
+
+bool WorkStealingQueue::pop(size_t thread_index, BlockPtr& block, bool& stolen) {
+    while (!take(thread_index, block, stolen)) {
+        if (size_.load(std::memory_order_acquire) != 0) {
+            // blocks are being taken by other threads right now, try again
+            std::this_thread::yield();
+            continue;
+        }
+        if (closed_.load(std::memory_order_acquire))
+            return false; // all blocks pushed before closing are handled
+
+        not_empty_.wait([this] {
+            return size_.load(std::memory_order_acquire) != 0
+                || closed_.load(std::memory_order_acquire);
+        });
+    }
+
+    size_.fetch_sub(1, std::memory_order_release);
+    not_full_.notify_one();
+    return true;
+}
+
+void WorkStealingQueue::close() {
+    closed_.store(true, std::memory_order_release);
+    not_empty_.notify_all();
+    not_full_.notify_all();
+}
+
+} // namespace griha
\ No newline at end of file
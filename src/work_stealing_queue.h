@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "block_queue.h"
+#include "wait_point.h"
+
+namespace griha {
+
+// Every consumer thread owns a deque. The reader distributes blocks among
+// deques by round robin, the owner takes blocks from the front of its deque
+// and an idle thread steals from the back of deques of other threads.
+// Blocks are numbered when pushed, so the oldest one can be found among
+// fronts of deques.
+class WorkStealingQueue : public BlockQueue {
+public:
+    WorkStealingQueue(size_t nthreads, size_t capacity = c_default_queue_capacity);
+
+    void push(BlockPtr block) override;
+    bool pop(size_t thread_index, BlockPtr& block, bool& stolen) override;
+    void close() override;
+
+    bool try_push(BlockPtr& block) override;
+    bool try_pop(size_t thread_index, BlockPtr& block, bool& stolen) override;
+    bool try_pop_oldest(BlockPtr& block) override;
+
+    size_t size() const override { return size_.load(std::memory_order_relaxed); }
+    size_t capacity() const override { return capacity_; }
+
+private:
+    struct Entry {
+        uint64_t seq;   // number of push
+        BlockPtr block;
+    };
+
+    struct alignas(c_cache_line_size) Local {
+        std::mutex guard;
+        std::deque<Entry> blocks;
+    };
+
+    void put(BlockPtr& block);
+    bool take(size_t thread_index, BlockPtr& block, bool& stolen);
+
+    const size_t nthreads_;
+    const size_t capacity_;
+    std::unique_ptr<Local[]> locals_;
+    size_t next_ { 0 }; // the reader is the only producer
+    uint64_t next_seq_ { 0 };
+
+    alignas(c_cache_line_size) std::atomic<size_t> size_ { 0 };
+    std::atomic<bool> closed_ { false };
+
+    WaitPoint not_empty_;
+    WaitPoint not_full_;
+};
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "backpressure_queue.h"
+#include "block.h"
+#include "counter.h"
+#include "executor.h"
+#include "histogram.h"
+#include "reader_subscriber.h"
+#include "trace.h"
+#include "wait_point.h"
+
+namespace griha {
+
+// job may take the block pointer to keep the block after returning
+template <typename Job>
+void invoke(Job& job, const BlockPtr& stms) {
+    if constexpr (std::is_invocable_v<Job&, const BlockPtr&>)
+        job(stms);
+    else
+        job(*stms);
+}
+
+// job may collect blocks and handle them when there is nothing to do
+template <typename Job, typename = void>
+struct has_flush : std::false_type {};
+
+template <typename Job>
+struct has_flush<Job, std::void_t<decltype(std::declval<Job&>().flush())>> : std::true_type {};
+
+// job may complete asynchronous work when the worker is joined
+template <typename Job, typename = void>
+struct has_finish : std::false_type {};
+
+template <typename Job>
+struct has_finish<Job, std::void_t<decltype(std::declval<Job&>().finish())>> : std::true_type {};
+
+inline uint64_t to_ns(std::chrono::steady_clock::duration d) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+}
+
+// copy of job used by one slot of worker
+struct Slot {
+    virtual ~Slot() {}
+    virtual void handle(const BlockPtr& stms) = 0;
+    virtual void flush() = 0;
+    virtual void finish() = 0;
+};
+
+template <typename Job>
+struct JobSlot : Slot {
+    explicit JobSlot(const Job& j) : job(j) {}
+
+    void handle(const BlockPtr& stms) override {
+        invoke(job, stms);
+    }
+
+    void flush() override {
+        if constexpr (has_flush<Job>::value)
+            job.flush();
+    }
+
+    void finish() override {
+        if constexpr (has_finish<Job>::value)
+            job.finish();
+    }
+
+    Job job;
+};
+
+// Sink of blocks run by threads of shared executor. Every slot of the lane
+// has its own copy of job and metrics. Exceptions of job don't leave
+// executor threads: the first one is kept and rethrown by join, blocks
+// sent after it are discarded, so the reader isn't blocked by full queue.
+struct Worker : ReaderSubscriber, Lane {
+
+    // counters of slot are read while it works, latencies are read
+    // when all blocks are handled
+    struct alignas(c_cache_line_size) Metrics {
+        Counter nblocks;
+        Counter nstatements;
+        Counter nsteals;
+        Counter nbytes;
+        Counter busy_ns;
+        Histogram queue_wait_us;    // from publishing to taking from queue
+        Histogram service_us;       // from taking from queue to handled
+        Histogram end_to_end_us;    // from the first statement to handled
+    };
+    
+    std::vector<Metrics> thread_metrics;
+    std::vector<std::unique_ptr<Slot>> slots;
+    BackpressureQueue bulks;
+    const ExecutorPtr executor;
+    const char* const name;     // category of trace events, string literal
+
+    std::atomic<bool> failed { false };
+    std::mutex error_guard;
+    std::exception_ptr error;   // the first exception of job
+
+    template <typename Job>
+    Worker(ExecutorPtr exec, const LaneOptions& lane, Job&& job, std::unique_ptr<BlockQueue> queue,
+           Overflow overflow, const std::string& spill_dir, const char* sink_name = "sink")
+        : thread_metrics(lane.concurrency)
+        , bulks(std::move(queue), overflow, spill_dir)
+        , executor(std::move(exec))
+        , name(sink_name) {
+        slots.reserve(lane.concurrency);
+        for (auto i = 0u; i < lane.concurrency; ++i) {
+            // every slot gets its own copy of job
+            slots.push_back(std::make_unique<JobSlot<std::decay_t<Job>>>(job));
+        }
+        executor->add(*this, lane);
+    }
+
+    ~Worker() {
+        executor->remove(*this);
+    }
+
+    // latency of all slots
+    Histogram latency(Histogram Metrics::*stage) const {
+        Histogram result;
+        for (auto& m : thread_metrics)
+            result.merge(m.*stage);
+        return result;
+    }
+
+    // time of handling blocks by all threads
+    uint64_t busy_ns() const {
+        uint64_t result = 0;
+        for (auto& m : thread_metrics)
+            result += m.busy_ns.get();
+        return result;
+    }
+
+    bool ready() const override {
+        return !bulks.empty();
+    }
+
+    size_t run(size_t slot, size_t max_tasks) override {
+        auto& job = *slots[slot];
+        auto& metrics = thread_metrics[slot];
+        BlockPtr stms;
+        bool stolen;
+        for (auto n = 0u; n < max_tasks; ++n) {
+            bool popped;
+            {
+                BULKMT_TRACE_SPAN("worker", "dequeue");
+                popped = bulks.try_pop(slot, stms, stolen);
+            }
+            if (!popped) {
+                BULKMT_TRACE_SPAN(name, "flush");
+                guarded([&job] { job.flush(); }); // nothing to do
+                return n;
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            {
+                BULKMT_TRACE_SPAN(name, "handle");
+                guarded([&job, &stms] { job.handle(stms); });
+            }
+            const auto end = std::chrono::steady_clock::now();
+
+            // calculate metrics
+            ++metrics.nblocks;
+            metrics.nstatements.add(stms->size());
+            metrics.nsteals.add(stolen);
+            metrics.nbytes.add(stms->bytes().size());
+            metrics.busy_ns.add(to_ns(end - start));
+            metrics.queue_wait_us.record(to_ns(start - stms->published()) / 1000u);
+            metrics.service_us.record(to_ns(end - start) / 1000u);
+            metrics.end_to_end_us.record(to_ns(end - stms->created()) / 1000u);
+
+            stms.reset(); // release block as soon as it's handled
+        }
+        return max_tasks;
+    }
+
+    void send(BlockPtr stms) {
+        BULKMT_TRACE_SPAN("worker", "send");
+        // overflow policy decides what to do when queue is full
+        bulks.push(std::move(stms));
+        executor->notify();
+    }
+
+    void stop() {
+        bulks.close();
+        executor->notify();
+    }
+
+    // waits until all queued blocks are handled; rethrows the first
+    // exception of job
+    void join() {
+        executor->drain(*this);
+        // slots aren't run by executor threads anymore
+        for (auto& slot : slots)
+            guarded([&slot] { slot->finish(); });
+        std::lock_guard<std::mutex> l { error_guard };
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    // calls job unless it has failed already
+    template <typename Call>
+    void guarded(Call&& call) {
+        if (failed.load(std::memory_order_acquire))
+            return;
+        try {
+            call();
+        } catch (...) {
+            std::lock_guard<std::mutex> l { error_guard };
+            if (!error)
+                error = std::current_exception();
+            failed.store(true, std::memory_order_release);
+        }
+    }
+
+    void on_block(const BlockPtr& stms) override {
+        // block is shared by all subscribers, queue holds pointer only
+        send(stms);
+    }
+
+    void on_unexpected_eof(const BlockPtr&) override {
+
+    }
+
+};
+
+using WorkerPtr = std::shared_ptr<Worker>;
+
+} // namespace griha
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include <catch2/catch.hpp>
+
+#include <cerrno>
+#include <climits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <affinity.h>
+
+#include "utils.h"
+
+using namespace std;
+using namespace griha;
+using namespace Catch;
+using namespace Catch::Matchers;
+
+TEST_CASE("Affinity - CPU list", "[affinity]") {
+    REQUIRE(parse_cpu_list("0") == CpuSet { 0 });
+    REQUIRE(parse_cpu_list("0-3") == (CpuSet { 0, 1, 2, 3 }));
+    REQUIRE(parse_cpu_list("8,0-2,10-11") == (CpuSet { 0, 1, 2, 8, 10, 11 }));
+    REQUIRE(parse_cpu_list("1,1,0-1") == (CpuSet { 0, 1 }));
+
+    REQUIRE_THROWS_AS(parse_cpu_list(""), invalid_argument);
+    REQUIRE_THROWS_AS(parse_cpu_list("1,"), invalid_argument);
+    REQUIRE_THROWS_AS(parse_cpu_list("a"), invalid_argument);
+    REQUIRE_THROWS_AS(parse_cpu_list("3-1"), invalid_argument);
+    REQUIRE_THROWS_AS(parse_cpu_list("-1"), invalid_argument);
+    REQUIRE_THROWS_AS(parse_cpu_list("100000"), invalid_argument);
+}
+
+TEST_CASE("Affinity - NUMA nodes", "[affinity]") {
+    REQUIRE(numa_nodes() >= 1u);
+    REQUIRE_FALSE(numa_node_cpus(0).empty());
+    REQUIRE_THROWS_AS(numa_node_cpus(static_cast<int>(numa_nodes())), invalid_argument);
+}
+
+TEST_CASE("Affinity - CPUs are checked against NUMA node", "[affinity]") {
+    AffinityOptions affinity;
+    affinity.executor = { 100000 };
+    REQUIRE_NOTHROW(check_affinity(affinity));
+
+    affinity.numa_node = 0;
+    REQUIRE_THROWS_AS(check_affinity(affinity), invalid_argument);
+    affinity.executor = numa_node_cpus(0);
+    // reader allocates blocks on the node wherever it runs
+    affinity.reader = { 100000 };
+    REQUIRE_NOTHROW(check_affinity(affinity));
+
+    affinity.numa_node = static_cast<int>(numa_nodes());
+    REQUIRE_THROWS_AS(check_affinity(affinity), invalid_argument);
+}
+
+TEST_CASE("Affinity - memory node", "[affinity]") {
+    const auto cpu = numa_node_cpus(0).front();
+    REQUIRE(cpu_node(cpu) == 0);
+    REQUIRE(cpu_node(100000) == -1);
+
+    AffinityOptions affinity;
+    REQUIRE(memory_node(affinity) == -1);
+    affinity.executor = { cpu };
+    REQUIRE(memory_node(affinity) == 0);
+    affinity.numa_node = 0;
+    affinity.executor.clear();
+    REQUIRE(memory_node(affinity) == 0);
+
+    // policy of other thread isn't changed
+    int mode = -1;
+    unsigned long mask = 0;
+    thread t { [&] {
+        prefer_node_memory(0);
+        if (syscall(SYS_get_mempolicy, &mode, &mask, sizeof(mask) * CHAR_BIT + 1, nullptr, 0ul) != 0
+                && errno == ENOSYS) {
+            mode = MPOL_PREFERRED; // kernel without NUMA
+            mask = 1;
+        }
+    } };
+    t.join();
+    REQUIRE(mode == MPOL_PREFERRED);
+    REQUIRE(mask == 1u);
+}
+
+TEST_CASE("Affinity - pinned thread", "[affinity]") {
+    const auto cpu = numa_node_cpus(0).back();
+    int running_cpu = -1;
+    thread t { [&] {
+        pin_current_thread({ cpu });
+        running_cpu = sched_getcpu();
+    } };
+    t.join();
+    REQUIRE(running_cpu == static_cast<int>(cpu));
+}
\ No newline at end of file
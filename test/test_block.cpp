@@ -0,0 +1,138 @@
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <block.h>
+#include <chunk_reader.h>
+#include <statement.h>
+
+#include "utils.h"
+
+using namespace std;
+using namespace griha;
+using namespace Catch;
+using namespace Catch::Matchers;
+
+namespace {
+
+// places content into the chunk and returns views of its lines
+vector<string_view> make_lines(InputChunkPtr& chunk, const string& content) {
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    REQUIRE(write(fds[1], content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+    close(fds[1]);
+
+    ChunkReader reader { fds[0] };
+    vector<string_view> lines;
+    string_view line;
+    while (reader.next_line(line))
+        lines.push_back(line);
+    chunk = reader.chunk();
+    close(fds[0]);
+    return lines;
+}
+
+struct TestExecuter : Executer {
+    vector<string> values;
+
+    void execute(const SomeStatement& stm) override {
+        values.emplace_back(stm.value());
+    }
+};
+
+} // unnamed namespace
+
+TEST_CASE("Block", "[block]") {
+    BlockBuilder builder;
+
+    SECTION("Empty block") {
+        auto block = builder.build();
+        REQUIRE(block->empty());
+        REQUIRE(block->bytes().empty());
+        REQUIRE(block->begin() == block->end());
+    }
+
+    SECTION("Copied values") {
+        builder.append("cmd1", nullptr);
+        builder.append("", nullptr);
+        builder.append("cmd3", nullptr);
+        REQUIRE_THAT(builder.size(), Equals(3));
+
+        auto block = builder.build();
+        REQUIRE(builder.empty());
+        REQUIRE_THAT(block->size(), Equals(3));
+        REQUIRE_THAT((*block)[0], Equals("cmd1"));
+        REQUIRE_THAT((*block)[1], Equals(""));
+        REQUIRE_THAT((*block)[2], Equals("cmd3"));
+        REQUIRE_THAT(block->bytes(), Equals("cmd1\n\ncmd3\n"));
+
+        vector<string> values { block->begin(), block->end() };
+        REQUIRE(values == vector<string> { "cmd1", "", "cmd3" });
+    }
+
+    SECTION("Adjacent lines of chunk are referred") {
+        InputChunkPtr chunk;
+        auto lines = make_lines(chunk, "cmd1\ncmd2\n{\ncmd3\n"s);
+
+        builder.append(lines[0], chunk);
+        builder.append(lines[1], chunk);
+        auto block = builder.build();
+        REQUIRE_THAT(block->size(), Equals(2));
+        REQUIRE(block->bytes().data() == lines[0].data());
+        REQUIRE_THAT(block->bytes(), Equals("cmd1\ncmd2\n"));
+
+        // gap between lines turns the builder to copy values
+        builder.append(lines[1], chunk);
+        builder.append(lines[3], chunk);
+        block = builder.build();
+        REQUIRE_THAT(block->size(), Equals(2));
+        REQUIRE(block->bytes().data() != lines[1].data());
+        REQUIRE_THAT((*block)[0], Equals("cmd2"));
+        REQUIRE_THAT((*block)[1], Equals("cmd3"));
+        REQUIRE_THAT(block->bytes(), Equals("cmd2\ncmd3\n"));
+    }
+
+    SECTION("Unterminated line of chunk is copied") {
+        InputChunkPtr chunk;
+        auto lines = make_lines(chunk, "cmd1\ncmd2"s);
+
+        builder.append(lines[0], chunk);
+        builder.append(lines[1], chunk);
+        auto block = builder.build();
+        chunk.reset();
+        REQUIRE_THAT((*block)[0], Equals("cmd1"));
+        REQUIRE_THAT((*block)[1], Equals("cmd2"));
+        REQUIRE_THAT(block->bytes(), Equals("cmd1\ncmd2\n"));
+    }
+
+    SECTION("Times of block") {
+        const auto before = chrono::steady_clock::now();
+        builder.append("cmd1", nullptr);
+        this_thread::sleep_for(chrono::milliseconds { 2 });
+        builder.append("cmd2", nullptr);
+        auto block = builder.build();
+        REQUIRE(block->created() >= before);
+        REQUIRE(block->published() - block->created() >= chrono::milliseconds { 2 });
+
+        // the next block starts with its first statement
+        builder.append("cmd3", nullptr);
+        REQUIRE(builder.build()->created() >= block->published());
+    }
+
+    SECTION("Block executed by statement visitor") {
+        builder.append("cmd1", nullptr);
+        builder.append("cmd2", nullptr);
+        auto block = builder.build();
+
+        TestExecuter executer;
+        static_cast<Executer&>(executer).execute(*block);
+        REQUIRE(executer.values == vector<string> { "cmd1", "cmd2" });
+    }
+}
\ No newline at end of file
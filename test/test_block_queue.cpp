@@ -0,0 +1,173 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <backpressure_queue.h>
+#include <block.h>
+#include <block_queue.h>
+#include <work_stealing_queue.h>
+
+#include "utils.h"
+
+using namespace std;
+using namespace griha;
+using namespace Catch;
+using namespace Catch::Matchers;
+
+TEST_CASE("BlockQueue - ring", "[block_queue]") {
+    RingBlockQueue queue { 4 };
+    queue.push(make_block({ "cmd1" }));
+    queue.push(make_block({ "cmd2" }));
+    REQUIRE_THAT(queue.size(), Equals(2));
+    queue.close();
+
+    BlockPtr block;
+    bool stolen = true;
+    REQUIRE(queue.pop(0, block, stolen));
+    REQUIRE_FALSE(stolen);
+    REQUIRE_THAT((*block)[0], Equals("cmd1"));
+    REQUIRE(queue.pop(1, block, stolen));
+    REQUIRE_THAT((*block)[0], Equals("cmd2"));
+    REQUIRE_FALSE(queue.pop(0, block, stolen));
+}
+
+TEST_CASE("BlockQueue - work stealing", "[block_queue]") {
+    WorkStealingQueue queue { 2, 8 };
+    // blocks are distributed by round robin
+    queue.push(make_block({ "cmd1" }));
+    queue.push(make_block({ "cmd2" }));
+    queue.push(make_block({ "cmd3" }));
+    queue.push(make_block({ "cmd4" }));
+    REQUIRE_THAT(queue.size(), Equals(4));
+    queue.close();
+
+    BlockPtr block;
+    bool stolen = true;
+    // own blocks are taken from the front
+    REQUIRE(queue.pop(0, block, stolen));
+    REQUIRE_FALSE(stolen);
+    REQUIRE_THAT((*block)[0], Equals("cmd1"));
+    REQUIRE(queue.pop(0, block, stolen));
+    REQUIRE_FALSE(stolen);
+    REQUIRE_THAT((*block)[0], Equals("cmd3"));
+    // blocks of other thread are stolen from the back
+    REQUIRE(queue.pop(0, block, stolen));
+    REQUIRE(stolen);
+    REQUIRE_THAT((*block)[0], Equals("cmd4"));
+    REQUIRE(queue.pop(1, block, stolen));
+    REQUIRE_FALSE(stolen);
+    REQUIRE_THAT((*block)[0], Equals("cmd2"));
+
+    REQUIRE_THAT(queue.size(), Equals(0));
+    REQUIRE_FALSE(queue.pop(0, block, stolen));
+    REQUIRE_FALSE(queue.pop(1, block, stolen));
+}
+
+TEST_CASE("BackpressureQueue", "[block_queue]") {
+    BlockPtr block;
+    bool stolen;
+
+    SECTION("Drop oldest") {
+        BackpressureQueue queue { make_unique<RingBlockQueue>(2), Overflow::drop_oldest };
+        for (auto i = 1; i <= 5; ++i)
+            queue.push(make_block({ "cmd"s + to_string(i) }));
+
+        auto metrics = queue.metrics();
+        REQUIRE_THAT(metrics.depth, Equals(2));
+        REQUIRE_THAT(metrics.high_water, Equals(2));
+        REQUIRE_THAT(metrics.ndropped, Equals(3));
+
+        queue.close();
+        REQUIRE(queue.pop(0, block, stolen));
+        REQUIRE_THAT((*block)[0], Equals("cmd4"));
+        REQUIRE(queue.pop(0, block, stolen));
+        REQUIRE_THAT((*block)[0], Equals("cmd5"));
+        REQUIRE_FALSE(queue.pop(0, block, stolen));
+    }
+
+    SECTION("Drop oldest of work stealing queue") {
+        BackpressureQueue queue { make_unique<WorkStealingQueue>(2, 3), Overflow::drop_oldest };
+        queue.push(make_block({ "cmd1" }));
+        queue.push(make_block({ "cmd2" }));
+        queue.push(make_block({ "cmd3" }));
+        REQUIRE(queue.try_pop(0, block, stolen));
+        REQUIRE_THAT((*block)[0], Equals("cmd1"));
+        // the oldest block is at the front of the other deque
+        queue.push(make_block({ "cmd4" }));
+        queue.push(make_block({ "cmd5" }));
+        REQUIRE_THAT(queue.metrics().ndropped, Equals(1));
+
+        queue.close();
+        vector<string> values;
+        while (queue.pop(0, block, stolen))
+            values.emplace_back((*block)[0]);
+        sort(values.begin(), values.end());
+        REQUIRE(values == vector<string> { "cmd3", "cmd4", "cmd5" });
+    }
+
+    SECTION("Spilled blocks are replayed by consumers") {
+        BackpressureQueue queue { make_unique<RingBlockQueue>(2), Overflow::spill, "." };
+        for (auto i = 1; i <= 4; ++i)
+            queue.push(make_block({ "cmd"s + to_string(i) }));
+        REQUIRE_THAT(queue.metrics().nspilled, Equals(2));
+
+        // no more blocks are pushed
+        vector<string> values;
+        while (queue.try_pop(0, block, stolen))
+            values.emplace_back((*block)[0]);
+        REQUIRE(values == vector<string> { "cmd1", "cmd2", "cmd3", "cmd4" });
+        REQUIRE(queue.empty());
+        REQUIRE_THAT(queue.metrics().depth, Equals(0));
+    }
+
+    SECTION("Spill and replay keep order of blocks") {
+        BackpressureQueue queue { make_unique<RingBlockQueue>(2), Overflow::spill, "." };
+        for (auto i = 1; i <= 5; ++i)
+            queue.push(make_block({ "cmd"s + to_string(i) }));
+
+        auto metrics = queue.metrics();
+        REQUIRE_THAT(metrics.depth, Equals(5));
+        REQUIRE_THAT(metrics.high_water, Equals(5));
+        REQUIRE_THAT(metrics.nspilled, Equals(3));
+
+        REQUIRE(queue.pop(0, block, stolen));
+        REQUIRE_THAT((*block)[0], Equals("cmd1"));
+
+        // spilled block is replayed before the new one is queued
+        queue.push(make_block({ "cmd6" }));
+        REQUIRE_THAT(queue.metrics().nspilled, Equals(4));
+
+        thread closer { [&queue] { queue.close(); } };
+        vector<string> values;
+        while (queue.pop(0, block, stolen))
+            values.emplace_back((*block)[0]);
+        closer.join();
+
+        REQUIRE(values == vector<string> { "cmd2", "cmd3", "cmd4", "cmd5", "cmd6" });
+        REQUIRE_THAT(queue.metrics().depth, Equals(0));
+    }
+
+    SECTION("Spilled block keeps its times") {
+        BackpressureQueue queue { make_unique<RingBlockQueue>(2), Overflow::spill, "." };
+        BlockPtr last;
+        for (auto i = 1; i <= 3; ++i) {
+            last = make_block({ "cmd"s + to_string(i) });
+            queue.push(last);
+        }
+        REQUIRE_THAT(queue.metrics().nspilled, Equals(1));
+
+        REQUIRE(queue.pop(0, block, stolen));
+        REQUIRE(queue.pop(0, block, stolen));
+        thread closer { [&queue] { queue.close(); } };
+        REQUIRE(queue.pop(0, block, stolen));
+        closer.join();
+        REQUIRE(block != last);
+        REQUIRE_THAT((*block)[0], Equals("cmd3"));
+        REQUIRE(block->created() == last->created());
+        REQUIRE(block->published() == last->published());
+    }
+}
\ No newline at end of file
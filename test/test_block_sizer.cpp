@@ -0,0 +1,122 @@
+#include <catch2/catch.hpp>
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <block.h>
+#include <block_sizer.h>
+#include <reader.h>
+#include <reader_subscriber.h>
+
+#include "utils.h"
+
+using namespace std;
+using namespace griha;
+using namespace Catch;
+using namespace Catch::Matchers;
+
+namespace {
+
+// returns size after n blocks
+size_t run_blocks(BlockSizer& sizer, size_t size, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        size = sizer.next_size(size);
+    return size;
+}
+
+struct SizeMonitor : ReaderSubscriber {
+    vector<size_t> sizes;
+
+    void on_block(const BlockPtr& block) override {
+        sizes.push_back(block->size());
+    }
+
+    void on_unexpected_eof(const BlockPtr&) override {}
+};
+
+// returns limits from the list one by one
+struct ListSizer : BlockSizer {
+    vector<size_t> limits;
+    size_t next { 0 };
+
+    size_t next_size(size_t current) override {
+        return next < limits.size() ? limits[next++] : current;
+    }
+};
+
+} // unnamed namespace
+
+TEST_CASE("AdaptiveBlockSizer", "[block_sizer]") {
+    constexpr auto period = AdaptiveBlockSizer::c_sample_period;
+
+    DownstreamLoad load { 0, 100, 0, 2 };
+    AdaptiveBlockSizer sizer { AdaptiveOptions { true, 2, 32 }, [&load] { return load; } };
+
+    SECTION("Size is kept between samples") {
+        load.depth = 100;
+        REQUIRE_THAT(run_blocks(sizer, 4, period - 1), Equals(4));
+        REQUIRE_THAT(run_blocks(sizer, 4, 1), Equals(8));
+    }
+
+    SECTION("Full queue grows blocks up to maximum") {
+        load.depth = 50;
+        REQUIRE_THAT(run_blocks(sizer, 4, period * 10), Equals(32));
+    }
+
+    SECTION("Busy threads grow blocks") {
+        // busy time grows faster than wall clock time
+        size_t size = 4;
+        for (auto i = 0u; i < 2; ++i) {
+            load.busy_ns += 3600ull * 1000000000ull;
+            size = run_blocks(sizer, size, period);
+        }
+        REQUIRE_THAT(size, Equals(16));
+    }
+
+    SECTION("Idle consumer shrinks blocks down to minimum") {
+        REQUIRE_THAT(run_blocks(sizer, 20, period * 10), Equals(2));
+    }
+
+    SECTION("Size is kept under moderate load") {
+        load.depth = 10;
+        REQUIRE_THAT(run_blocks(sizer, 8, period * 4), Equals(8));
+    }
+
+    SECTION("Current size is clamped") {
+        load.depth = 10;
+        REQUIRE_THAT(sizer.next_size(100), Equals(32));
+        REQUIRE_THAT(sizer.next_size(1), Equals(2));
+    }
+}
+
+TEST_CASE("Reader - adaptive block size", "[block_sizer]") {
+
+    Reader reader(2);
+    auto monitor = make_shared<SizeMonitor>();
+    auto sizer = make_shared<ListSizer>();
+    sizer->limits = { 3, 3, 1 };
+    reader.subscribe(monitor);
+    reader.adapt_block_size(sizer);
+
+    istringstream is;
+    is.str(
+        "cmd1\n"
+        "cmd2\n"
+        "cmd3\n"
+        "cmd4\n"
+        "cmd5\n"
+        "cmd6\n"
+        "cmd7\n"
+        "cmd8\n"
+        "cmd9\n"
+        "{\n"
+        "cmd10\n"
+        "}\n"
+        "cmd11\n"s);
+
+    auto metrics = reader.run(is);
+    REQUIRE(monitor->sizes == (vector<size_t> { 2, 3, 3, 1, 1, 1 }));
+    REQUIRE(metrics.block_sizes == (map<size_t, size_t> { { 2, 1 }, { 3, 2 }, { 1, 2 } }));
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+
+#include <block.h>
+#include <chunk_reader.h>
+#include <reader.h>
+#include <reader_subscriber.h>
+
+#include "utils.h"
+
+using namespace std;
+using namespace griha;
+using namespace Catch;
+using namespace Catch::Matchers;
+
+namespace {
+
+// writes content to the pipe and returns read end of it
+int make_pipe(const string& content) {
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    REQUIRE(write(fds[1], content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+    close(fds[1]);
+    return fds[0];
+}
+
+// writes content to the temporary regular file and returns descriptor of it
+int make_file(const string& content) {
+    auto file = tmpfile();
+    REQUIRE(file != nullptr);
+    REQUIRE(fwrite(content.data(), 1, content.size(), file) == content.size());
+    fflush(file);
+    auto fd = dup(fileno(file));
+    fclose(file);
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
+vector<string> read_lines(ChunkReader& reader, vector<InputChunkPtr>& chunks) {
+    vector<string> lines;
+    string_view line;
+    while (reader.next_line(line)) {
+        lines.emplace_back(line);
+        chunks.push_back(reader.chunk());
+    }
+    return lines;
+}
+
+} // unnamed namespace
+
+TEST_CASE("ChunkReader", "[chunk_reader]") {
+    const auto content =
+        "cmd1\n"
+        "command2\n"
+        "\n"
+        "very long command 3\n"
+        "cmd4"s;
+    const vector<string> expected { "cmd1", "command2", "", "very long command 3", "cmd4" };
+
+    SECTION("Pipe - lines cross chunk boundaries") {
+        auto fd = make_pipe(content);
+        ChunkReader reader { fd, 4 };
+        vector<InputChunkPtr> chunks;
+        REQUIRE(read_lines(reader, chunks) == expected);
+        REQUIRE(reader.nchunks() > 1);
+        close(fd);
+    }
+
+    SECTION("Pipe - terminating new line") {
+        auto fd = make_pipe(content + "\n");
+        ChunkReader reader { fd };
+        vector<InputChunkPtr> chunks;
+        REQUIRE(read_lines(reader, chunks) == expected);
+        REQUIRE_THAT(reader.nchunks(), Equals(1));
+        close(fd);
+    }
+
+    SECTION("Regular file is mapped by single chunk") {
+        auto fd = make_file(content);
+        ChunkReader reader { fd, 4 };
+        vector<InputChunkPtr> chunks;
+        REQUIRE(read_lines(reader, chunks) == expected);
+        REQUIRE_THAT(reader.nchunks(), Equals(1));
+        close(fd);
+    }
+
+    SECTION("Empty input") {
+        auto fd = make_pipe(""s);
+        ChunkReader reader { fd };
+        string_view line;
+        REQUIRE_FALSE(reader.next_line(line));
+        close(fd);
+    }
+}
+
+TEST_CASE("Reader - chunked input", "[reader][chunk_reader]") {
+
+    struct Monitor : ReaderSubscriber {
+        vector<BlockPtr> blocks;
+        void on_block(const BlockPtr& stms) override { blocks.push_back(stms); }
+        void on_unexpected_eof(const BlockPtr&) override {}
+    };
+
+    Reader reader(2);
+    auto monitor = make_shared<Monitor>();
+    reader.subscribe(monitor);
+
+    auto fd = make_pipe(
+        "cmd1\n"
+        "cmd2\n"
+        "{\n"
+        "cmd3\n"
+        "}\n"
+        "cmd4\n"s);
+
+    auto metrics = reader.run(fd);
+    close(fd);
+    REQUIRE_THAT(metrics.nlines, Equals(6));
+    REQUIRE_THAT(metrics.nstatements, Equals(4));
+    REQUIRE_THAT(metrics.nblocks, Equals(3));
+    REQUIRE_THAT(metrics.nchunks, Equals(1));
+
+    REQUIRE_THAT(monitor->blocks.size(), Equals(3));
+    REQUIRE_THAT((*monitor->blocks[0])[1], Equals("cmd2"));
+    REQUIRE_THAT((*monitor->blocks[1])[0], Equals("cmd3"));
+    REQUIRE_THAT((*monitor->blocks[2])[0], Equals("cmd4"));
+}
\ No newline at end of file
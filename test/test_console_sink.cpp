@@ -0,0 +1,111 @@
+#include <catch2/catch.hpp>
+
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <block.h>
+#include <block_queue.h>
+#include <console_sink.h>
+#include <executor.h>
+#include <worker.h>
+
+#include "utils.h"
+
+using namespace std;
+using namespace griha;
+using namespace Catch;
+using namespace Catch::Matchers;
+
+namespace {
+
+// everything written into pipe so far
+string read_pipe(int fd) {
+    string result;
+    char buffer[256];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+        result.append(buffer, static_cast<size_t>(n));
+    return result;
+}
+
+} // unnamed namespace
+
+TEST_CASE("ConsoleSink", "[console_sink]") {
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+    ConsoleOptions options;
+
+    SECTION("per bulk") {
+        ConsoleSink sink { options, fds[1] };
+        sink(*make_block({ "cmd1", "cmd2", "cmd3" }));
+        REQUIRE_THAT(read_pipe(fds[0]), Equals("bulk: cmd1, cmd2, cmd3\n"s));
+        sink(*make_block({ "cmd4" }));
+        REQUIRE_THAT(read_pipe(fds[0]), Equals("bulk: cmd4\n"s));
+    }
+
+    SECTION("empty values") {
+        ConsoleSink sink { options, fds[1] };
+        sink(*make_block({ "", "cmd1", "", "" }));
+        REQUIRE_THAT(read_pipe(fds[0]), Equals("bulk: , cmd1, , \n"s));
+        sink(*make_block({ "" }));
+        REQUIRE_THAT(read_pipe(fds[0]), Equals("bulk: \n"s));
+        sink(*make_block({}));
+        REQUIRE_THAT(read_pipe(fds[0]), Equals("bulk: \n"s));
+    }
+
+    SECTION("by size") {
+        options.flush = ConsoleFlush::by_size;
+        options.flush_size = 32;
+        {
+            ConsoleSink sink { options, fds[1] };
+            sink(*make_block({ "cmd1", "cmd2" }));
+            REQUIRE(read_pipe(fds[0]).empty());
+            sink(*make_block({ "cmd3", "cmd4" }));
+            REQUIRE_THAT(read_pipe(fds[0]), Equals("bulk: cmd1, cmd2\nbulk: cmd3, cmd4\n"s));
+            sink(*make_block({ "cmd5" }));
+            REQUIRE(read_pipe(fds[0]).empty());
+        }
+        // rest is written by destructor
+        REQUIRE_THAT(read_pipe(fds[0]), Equals("bulk: cmd5\n"s));
+    }
+
+    SECTION("by time") {
+        options.flush = ConsoleFlush::by_time;
+        options.flush_interval = chrono::milliseconds { 10 };
+        ConsoleSink sink { options, fds[1] };
+        sink(*make_block({ "cmd1" }));
+        REQUIRE(read_pipe(fds[0]).empty());
+        this_thread::sleep_for(chrono::milliseconds { 20 });
+        sink(*make_block({ "cmd2" }));
+        REQUIRE_THAT(read_pipe(fds[0]), Equals("bulk: cmd1\nbulk: cmd2\n"s));
+        sink(*make_block({ "cmd3" }));
+        sink.flush();
+        REQUIRE_THAT(read_pipe(fds[0]), Equals("bulk: cmd3\n"s));
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST_CASE("ConsoleSink - write error is reported by worker", "[console_sink][worker]") {
+    const auto fd = open("/dev/full", O_WRONLY);
+    REQUIRE(fd >= 0);
+    {
+        auto executor = make_shared<Executor>(1);
+        Worker worker { executor, { 1, 1, 0 }, ConsoleSink { ConsoleOptions {}, fd },
+                        make_unique<RingBlockQueue>(4), Overflow::block, "." };
+        for (auto i = 0; i < 8; ++i)
+            worker.send(make_block({ "cmd1", "cmd2" }));
+        worker.stop();
+        REQUIRE_THROWS_AS(worker.join(), system_error);
+    }
+    close(fd);
+}
\ No newline at end of file
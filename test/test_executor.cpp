@@ -0,0 +1,183 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <block.h>
+#include <block_queue.h>
+#include <executor.h>
+#include <worker.h>
+
+#include "utils.h"
+
+using namespace std;
+using namespace griha;
+using namespace Catch;
+using namespace Catch::Matchers;
+
+namespace {
+
+// Lane of counted tasks. It isn't ready until it's opened, so all lanes
+// of test can be added before any task is run.
+struct CountingLane : Lane {
+    atomic<bool> open { false };
+    atomic<size_t> npending { 0 };
+    size_t tasks_per_run;
+    chrono::microseconds task_time;
+    // order of runs of all lanes
+    string name;
+    mutex* guard;
+    string* journal;
+
+    atomic<size_t> nrunning { 0 };
+    atomic<size_t> max_running { 0 };
+
+    CountingLane(string lane_name, size_t ntasks, mutex& g, string& j,
+                 size_t per_run = Executor::c_batch_size, chrono::microseconds time = {})
+        : npending(ntasks), tasks_per_run(per_run), task_time(time)
+        , name(move(lane_name)), guard(&g), journal(&j) {}
+
+    bool ready() const override {
+        return open && npending > 0;
+    }
+
+    size_t run(size_t, size_t max_tasks) override {
+        const auto running = ++nrunning;
+        auto max = max_running.load();
+        while (running > max && !max_running.compare_exchange_weak(max, running));
+
+        size_t n = 0;
+        for (; n < min(max_tasks, tasks_per_run); ++n) {
+            auto pending = npending.load();
+            do {
+                if (pending == 0)
+                    break;
+            } while (!npending.compare_exchange_weak(pending, pending - 1));
+            if (pending == 0)
+                break;
+
+            if (task_time.count() > 0)
+                this_thread::sleep_for(task_time);
+            lock_guard<mutex> l { *guard };
+            *journal += name;
+        }
+
+        --nrunning;
+        return n;
+    }
+};
+
+} // unnamed namespace
+
+TEST_CASE("Executor - concurrency limit", "[executor]") {
+    mutex guard;
+    string journal;
+    Executor executor { 4 };
+
+    CountingLane lane { "a", 200, guard, journal, 1, chrono::microseconds { 200 } };
+    executor.add(lane, { 2, 1, 0 });
+    lane.open = true;
+    executor.notify();
+
+    executor.drain(lane);
+    executor.remove(lane);
+
+    REQUIRE(lane.npending == 0);
+    REQUIRE(journal.size() == 200u);
+    REQUIRE(lane.max_running <= 2u);
+}
+
+TEST_CASE("Executor - priority", "[executor]") {
+    mutex guard;
+    string journal;
+    Executor executor { 1 };
+
+    CountingLane low { "l", 100, guard, journal };
+    CountingLane high { "h", 100, guard, journal };
+    executor.add(low, { 1, 1, 0 });
+    executor.add(high, { 1, 1, 1 });
+    high.open = true;
+    low.open = true;
+    executor.notify();
+
+    executor.drain(low);
+    executor.drain(high);
+    executor.remove(low);
+    executor.remove(high);
+
+    REQUIRE_THAT(journal, Equals(string(100, 'h') + string(100, 'l')));
+}
+
+TEST_CASE("Executor - weights", "[executor]") {
+    mutex guard;
+    string journal;
+    Executor executor { 1 };
+
+    CountingLane heavy { "h", 1000, guard, journal, 1 };
+    CountingLane light { "l", 1000, guard, journal, 1 };
+    executor.add(heavy, { 1, 3, 0 });
+    executor.add(light, { 1, 1, 0 });
+    heavy.open = true;
+    light.open = true;
+    executor.notify();
+
+    executor.drain(heavy);
+    executor.drain(light);
+    executor.remove(heavy);
+    executor.remove(light);
+
+    REQUIRE(journal.size() == 2000u);
+    // while both lanes are ready heavy one gets three runs of four
+    const auto nheavy = count(journal.begin(), journal.begin() + 400, 'h');
+    REQUIRE(nheavy >= 290);
+    REQUIRE(nheavy <= 310);
+}
+
+TEST_CASE("Executor - lanes are added and removed while running", "[executor]") {
+    mutex guard;
+    string journal;
+    Executor executor { 2 };
+
+    for (auto i = 0; i < 20; ++i) {
+        CountingLane lane { "a", 10, guard, journal, 1 };
+        executor.add(lane, { 2, 1, 0 });
+        lane.open = true;
+        executor.notify();
+        executor.drain(lane);
+        executor.remove(lane);
+        REQUIRE(lane.npending == 0);
+    }
+    REQUIRE(journal.size() == 200u);
+}
+
+TEST_CASE("Worker - exception of job is rethrown by join", "[executor][worker]") {
+    auto executor = make_shared<Executor>(2);
+    atomic<size_t> nhandled { 0 };
+    auto job = [&nhandled] (const Block& block) {
+        ++nhandled;
+        if (block.id() == 2)
+            throw runtime_error { "can't handle block" };
+    };
+    Worker worker { executor, { 2, 1, 0 }, job, make_unique<RingBlockQueue>(2),
+                    Overflow::block, "." };
+
+    // queue is smaller than number of blocks, so the reader would hang
+    // if blocks weren't taken after the failure
+    BlockBuilder builder;
+    for (uint64_t id = 1; id <= 16; ++id) {
+        builder.append("cmd", nullptr);
+        worker.send(builder.build(id));
+    }
+    worker.stop();
+
+    REQUIRE_THROWS_WITH(worker.join(), "can't handle block");
+    REQUIRE(worker.bulks.empty());
+    REQUIRE(nhandled < 16);
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+
+#include <histogram.h>
+
+#include "utils.h"
+
+using namespace std;
+using namespace griha;
+using namespace Catch;
+using namespace Catch::Matchers;
+
+TEST_CASE("Histogram", "[histogram]") {
+
+    Histogram histogram;
+
+    SECTION("Empty") {
+        REQUIRE_THAT(histogram.count(), Equals(0));
+        REQUIRE_THAT(histogram.percentile(50), Equals(0));
+        REQUIRE_THAT(histogram.max(), Equals(0));
+    }
+
+    SECTION("Small values are exact") {
+        for (uint64_t v = 1; v <= 10; ++v)
+            histogram.record(v);
+        REQUIRE_THAT(histogram.count(), Equals(10));
+        REQUIRE_THAT(histogram.percentile(0), Equals(1));
+        REQUIRE_THAT(histogram.percentile(50), Equals(5));
+        REQUIRE_THAT(histogram.percentile(90), Equals(9));
+        REQUIRE_THAT(histogram.percentile(100), Equals(10));
+        REQUIRE_THAT(histogram.max(), Equals(10));
+    }
+
+    SECTION("Large values are within 1/8") {
+        for (uint64_t v = 1; v <= 100000; ++v)
+            histogram.record(v);
+        const auto p50 = histogram.percentile(50);
+        const auto p99 = histogram.percentile(99);
+        REQUIRE(p50 >= 50000);
+        REQUIRE(p50 <= 50000 + 50000 / 8);
+        REQUIRE(p99 >= 99000);
+        REQUIRE(p99 <= 100000);
+        REQUIRE_THAT(histogram.percentile(100), Equals(100000));
+
+        histogram.record(UINT64_MAX);
+        REQUIRE_THAT(histogram.max(), Equals(UINT64_MAX));
+        REQUIRE_THAT(histogram.percentile(100), Equals(UINT64_MAX));
+    }
+
+    SECTION("Clear") {
+        histogram.record(1000);
+        histogram.clear();
+        REQUIRE_THAT(histogram.count(), Equals(0));
+        REQUIRE_THAT(histogram.percentile(99), Equals(0));
+    }
+
+    SECTION("Merge") {
+        Histogram other;
+        for (uint64_t v = 1; v <= 5; ++v)
+            histogram.record(v);
+        for (uint64_t v = 6; v <= 10; ++v)
+            other.record(v);
+        histogram.merge(other);
+        REQUIRE_THAT(histogram.count(), Equals(10));
+        REQUIRE_THAT(histogram.percentile(50), Equals(5));
+        REQUIRE_THAT(histogram.max(), Equals(10));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <chunk_reader.h>
+#include <line_scanner.h>
+
+#include "utils.h"
+
+using namespace std;
+using namespace griha;
+using namespace Catch;
+using namespace Catch::Matchers;
+
+namespace {
+
+struct Line {
+    string value;
+    LineKind kind;
+
+    bool operator== (const Line& other) const { return value == other.value && kind == other.kind; }
+};
+
+vector<Line> scan(ScanIsa isa, const string& input, string& rest) {
+    vector<LineSpan> spans(input.size());
+    const auto nspans = scan_lines(isa, input.data(), input.data(), input.data() + input.size(), spans.data());
+
+    vector<Line> lines;
+    size_t begin = 0;
+    for (auto i = 0u; i < nspans; ++i) {
+        lines.push_back({ input.substr(begin, spans[i].end() - begin), spans[i].kind() });
+        begin = spans[i].end() + 1;
+    }
+    rest = input.substr(begin);
+    return lines;
+}
+
+} // unnamed namespace
+
+TEST_CASE("LineScanner", "[line_scanner]") {
+    const auto isa = GENERATE(ScanIsa::scalar, ScanIsa::sse2, ScanIsa::avx2);
+    if (!is_supported(isa))
+        return;
+
+    SECTION("kinds") {
+        string rest;
+        auto lines = scan(isa, "cmd1\n{\n}\n{}\n\n {\ncmd2"s, rest);
+        vector<Line> expected {
+            { "cmd1", LineKind::statement },
+            { "{", LineKind::block_begin },
+            { "}", LineKind::block_end },
+            { "{}", LineKind::statement },
+            { "", LineKind::statement },
+            { " {", LineKind::statement }
+        };
+        REQUIRE(lines == expected);
+        REQUIRE_THAT(rest, Equals("cmd2"s));
+    }
+
+    SECTION("lines cross vector boundaries") {
+        string input;
+        vector<Line> expected;
+        for (auto i = 0u; i < 100; ++i) {
+            auto value = string(i % 37, 'a') + to_string(i);
+            if (i % 10 == 0)
+                value = i % 20 == 0 ? "{" : "}";
+            input += value + '\n';
+            expected.push_back({ value, classify_line(value) });
+        }
+
+        string rest;
+        REQUIRE(scan(isa, input, rest) == expected);
+        REQUIRE(rest.empty());
+    }
+
+    SECTION("search starts from position") {
+        const auto input = "{\nabc\n"s;
+        vector<LineSpan> spans(input.size());
+        // the first line begins before window
+        REQUIRE_THAT(scan_lines(isa, input.data(), input.data() + 1, input.data() + input.size(), spans.data()),
+                     Equals(2));
+        REQUIRE(spans[0].kind() == LineKind::block_begin);
+        REQUIRE_THAT(spans[0].end(), Equals(0));
+        REQUIRE_THAT(spans[1].end(), Equals(4));
+    }
+}
+
+TEST_CASE("ChunkReader - line kinds", "[line_scanner][chunk_reader]") {
+    // line longer than scan window
+    const auto long_line = string(c_scan_window * 2 + 5, 'x');
+    const auto content = "{\n" + long_line + "\n}\ncmd"s;
+
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    const auto isa = GENERATE(ScanIsa::scalar, ScanIsa::sse2, ScanIsa::avx2);
+    // pipe buffer is smaller than content
+    thread writer { [&content, fd = fds[1]] {
+        for (size_t pos = 0; pos < content.size(); ) {
+            auto n = write(fd, content.data() + pos, content.size() - pos);
+            if (n <= 0)
+                break;
+            pos += static_cast<size_t>(n);
+        }
+        close(fd);
+    } };
+
+    ChunkReader reader { fds[0], 1024, isa };
+    vector<Line> lines;
+    string_view line;
+    LineKind kind;
+    while (reader.next_line(line, kind))
+        lines.push_back({ string { line }, kind });
+    writer.join();
+    close(fds[0]);
+
+    vector<Line> expected {
+        { "{", LineKind::block_begin },
+        { long_line, LineKind::statement },
+        { "}", LineKind::block_end },
+        { "cmd", LineKind::statement }
+    };
+    REQUIRE(lines == expected);
+}
\ No newline at end of file
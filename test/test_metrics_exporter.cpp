@@ -0,0 +1,126 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <counter.h>
+#include <metrics_exporter.h>
+#include <socket_address.h>
+
+#include "utils.h"
+
+using namespace std;
+using namespace griha;
+using namespace Catch;
+using namespace Catch::Matchers;
+
+namespace {
+
+vector<string> read_lines(const string& path) {
+    ifstream input { path };
+    vector<string> lines;
+    for (string line; getline(input, line); )
+        lines.push_back(line);
+    return lines;
+}
+
+string read_all(int fd) {
+    string result;
+    char buffer[256];
+    for (ssize_t n; (n = read(fd, buffer, sizeof(buffer))) > 0; )
+        result.append(buffer, static_cast<size_t>(n));
+    return result;
+}
+
+} // unnamed namespace
+
+TEST_CASE("Metrics exporter - file", "[metrics_exporter]") {
+    const auto path = "bulkmt_metrics_" + to_string(getpid()) + ".json";
+    remove(path.c_str());
+
+    Counter counter;
+    {
+        ExportOptions options;
+        options.file = path;
+        options.period = chrono::milliseconds { 10 };
+        MetricsExporter exporter { options, [&counter] (ostream& os) {
+            os << "{\"value\":" << counter.get() << '}';
+        } };
+
+        for (auto i = 0; i < 10; ++i) {
+            ++counter;
+            this_thread::sleep_for(chrono::milliseconds { 5 });
+        }
+        counter.add(90);
+    }
+
+    const auto lines = read_lines(path);
+    remove(path.c_str());
+
+    // periodic snapshots and the final one
+    REQUIRE(lines.size() >= 2u);
+    REQUIRE_THAT(lines.back(), Equals("{\"value\":100}"s));
+    for (auto& line : lines)
+        REQUIRE_THAT(line, StartsWith("{\"value\":") && EndsWith("}"));
+}
+
+TEST_CASE("Metrics exporter - socket", "[metrics_exporter]") {
+    const auto address = "unix:/tmp/bulkmt_metrics_" + to_string(getpid()) + ".sock";
+
+    Counter counter;
+    ExportOptions options;
+    options.socket = address;
+    MetricsExporter exporter { options, [&counter] (ostream& os) {
+        os << "{\"value\":" << counter.get() << '}';
+    } };
+
+    for (auto value : { 0, 42 }) {
+        counter.add(static_cast<uint64_t>(value));
+        const auto fd = connect_socket(parse_socket_address(address));
+        const auto snapshot = read_all(fd);
+        close(fd);
+        REQUIRE_THAT(snapshot, Equals("{\"value\":" + to_string(value) + "}\n"));
+    }
+}
+
+TEST_CASE("Metrics exporter - stalled client", "[metrics_exporter]") {
+    const auto path = "bulkmt_metrics_" + to_string(getpid()) + ".json";
+    const auto address = "unix:/tmp/bulkmt_metrics_" + to_string(getpid()) + ".sock";
+    remove(path.c_str());
+
+    size_t nlines = 0;
+    {
+        ExportOptions options;
+        options.file = path;
+        options.socket = address;
+        options.period = chrono::milliseconds { 10 };
+        // snapshot doesn't fit into buffer of socket
+        MetricsExporter exporter { options, [] (ostream& os) {
+            os << string(1u << 20, 'x');
+        } };
+
+        // client doesn't read, exporter keeps writing the file
+        const auto fd = connect_socket(parse_socket_address(address));
+        this_thread::sleep_for(chrono::milliseconds { 20 });
+        nlines = read_lines(path).size();
+        this_thread::sleep_for(chrono::milliseconds { 100 });
+        nlines = read_lines(path).size() - nlines;
+        close(fd);
+    }
+    remove(path.c_str());
+    REQUIRE(nlines >= 2u);
+}
+
+TEST_CASE("Metrics exporter - bad file", "[metrics_exporter]") {
+    ExportOptions options;
+    options.file = "no_such_dir/metrics.json";
+    REQUIRE_THROWS_AS(MetricsExporter(options, [] (ostream&) {}), system_error);
+}
\ No newline at end of file
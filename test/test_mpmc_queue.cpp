@@ -0,0 +1,90 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <mpmc_queue.h>
+
+#include "utils.h"
+
+using namespace std;
+using namespace griha;
+using namespace Catch;
+using namespace Catch::Matchers;
+
+TEST_CASE("MpmcQueue", "[mpmc_queue]") {
+
+    SECTION("FIFO order and capacity") {
+        MpmcQueue<unique_ptr<int>> queue { 3 };
+        REQUIRE_THAT(queue.capacity(), Equals(4));
+        REQUIRE(queue.empty());
+
+        for (auto i = 0; i < 4; ++i) {
+            auto value = make_unique<int>(i);
+            REQUIRE(queue.try_push(value));
+            REQUIRE_FALSE(value);
+        }
+        auto extra = make_unique<int>(4);
+        REQUIRE_FALSE(queue.try_push(extra));
+        REQUIRE(extra); // value isn't moved out if push fails
+        REQUIRE_THAT(queue.size(), Equals(4));
+
+        unique_ptr<int> value;
+        for (auto i = 0; i < 4; ++i) {
+            REQUIRE(queue.try_pop(value));
+            REQUIRE_THAT(*value, Equals(i));
+        }
+        REQUIRE_FALSE(queue.try_pop(value));
+    }
+
+    SECTION("Closed queue is drained before pop fails") {
+        MpmcQueue<int> queue { 4 };
+        queue.push(1);
+        queue.push(2);
+        queue.close();
+
+        int value;
+        REQUIRE(queue.pop(value));
+        REQUIRE_THAT(value, Equals(1));
+        REQUIRE(queue.pop(value));
+        REQUIRE_THAT(value, Equals(2));
+        REQUIRE_FALSE(queue.pop(value));
+    }
+
+    SECTION("Multiple producers and consumers") {
+        constexpr auto nthreads = 4;
+        constexpr auto nvalues = 10000;
+
+        MpmcQueue<int> queue { 16 };
+        atomic<long> sum { 0 };
+        atomic<int> count { 0 };
+
+        vector<thread> consumers;
+        for (auto i = 0; i < nthreads; ++i)
+            consumers.emplace_back([&] {
+                int value;
+                while (queue.pop(value)) {
+                    sum += value;
+                    ++count;
+                }
+            });
+
+        vector<thread> producers;
+        for (auto i = 0; i < nthreads; ++i)
+            producers.emplace_back([&] {
+                for (auto v = 1; v <= nvalues; ++v)
+                    queue.push(v);
+            });
+
+        for (auto& t : producers)
+            t.join();
+        queue.close();
+        for (auto& t : consumers)
+            t.join();
+
+        REQUIRE_THAT(count.load(), Equals(nthreads * nvalues));
+        REQUIRE(sum.load() == nthreads * (nvalues * (nvalues + 1L) / 2));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <system_error>
+
+#include <unistd.h>
+
+#include <block.h>
+#include <block_queue.h>
+#include <executor.h>
+#include <output_engine.h>
+#include <worker.h>
+
+#include "utils.h"
+
+using namespace std;
+using namespace griha;
+using namespace Catch;
+using namespace Catch::Matchers;
+
+TEST_CASE("OutputEngine", "[output_engine]") {
+    const auto dir = make_temp_dir("output");
+
+    const auto backend = GENERATE(OutputBackend::uring, OutputBackend::pool);
+    const size_t nfiles = 100;
+    const auto filename = [&dir] (size_t i) { return dir + "/bulk_" + to_string(i) + ".log"; };
+
+    {
+        // files in flight are limited by small depth
+        auto engine = make_output_engine(backend, 4);
+        for (auto i = 0u; i < nfiles; ++i) {
+            engine->write(filename(i), make_block({ "cmd" + to_string(i), "cmd" + to_string(i) }));
+            if (i % 10 == 0)
+                engine->submit();
+        }
+        engine->drain();
+    }
+
+    for (auto i = 0u; i < nfiles; ++i) {
+        const auto value = "cmd" + to_string(i);
+        REQUIRE_THAT(read_file(filename(i)), Equals(value + "\n" + value + "\n"));
+        remove(filename(i).c_str());
+    }
+
+    SECTION("error") {
+        auto engine = make_output_engine(backend, 4);
+        engine->write(dir + "/missing/bulk.log", make_block({ "cmd", "cmd" }));
+        REQUIRE_THROWS_AS(engine->drain(), system_error);
+    }
+
+    rmdir(dir.c_str());
+}
+
+TEST_CASE("OutputEngine - available backend", "[output_engine]") {
+    REQUIRE(available_backend(OutputBackend::pool) == OutputBackend::pool);
+    REQUIRE(available_backend(OutputBackend::stream) == OutputBackend::stream);
+    const auto uring = available_backend(OutputBackend::uring);
+    REQUIRE((uring == OutputBackend::uring || uring == OutputBackend::pool));
+    REQUIRE_THAT(backend_name(OutputBackend::pool), Equals("thread pool"));
+}
+
+TEST_CASE("OutputSink - write error is reported by worker", "[output_engine][worker]") {
+    // current directory is removed, so files can't be created
+    const auto dir = make_temp_dir("sink");
+    char cwd[4096];
+    REQUIRE(getcwd(cwd, sizeof(cwd)) != nullptr);
+    REQUIRE(chdir(dir.c_str()) == 0);
+    rmdir(dir.c_str());
+
+    const auto backend = GENERATE(OutputBackend::uring, OutputBackend::pool);
+    {
+        auto executor = make_shared<Executor>(2);
+        Worker worker { executor, { 2, 1, 0 }, OutputSink { backend, 4, 1 },
+                        make_unique<RingBlockQueue>(4), Overflow::block, "." };
+        for (auto i = 0; i < 8; ++i)
+            worker.send(make_block({ "cmd", "cmd" }));
+        worker.stop();
+        REQUIRE_THROWS_AS(worker.join(), system_error);
+    }
+    REQUIRE(chdir(cwd) == 0);
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <block.h>
+#include <reader.h>
+#include <reader_subscriber.h>
+
+#include "utils.h"
+
+using namespace std;
+using namespace griha;
+using namespace Catch;
+using namespace Catch::Matchers;
+
+namespace {
+
+struct Recorder : ReaderSubscriber {
+    vector<string> events;
+
+    void record(const char* prefix, const Block& block) {
+        auto event = string { prefix } + to_string(block.id()) + ":";
+        for (auto value : block)
+            event.append(value).append(",");
+        events.push_back(event);
+    }
+
+    void on_block(const BlockPtr& block) override { record("block ", *block); }
+    void on_unexpected_eof(const BlockPtr& block) override { record("eof ", *block); }
+};
+
+int make_file(const string& content) {
+    auto file = tmpfile();
+    REQUIRE(file != nullptr);
+    REQUIRE(fwrite(content.data(), 1, content.size(), file) == content.size());
+    fflush(file);
+    auto fd = dup(fileno(file));
+    fclose(file);
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
+// runs reader sequentially and in parallel and compares results
+void compare(const string& content, size_t block_size, size_t chunk_size) {
+    auto sequential = make_shared<Recorder>();
+    Reader sequential_reader { block_size };
+    sequential_reader.subscribe(sequential);
+    auto fd = make_file(content);
+    const auto expected = sequential_reader.run(fd);
+    close(fd);
+
+    auto parallel = make_shared<Recorder>();
+    Reader parallel_reader { block_size };
+    parallel_reader.subscribe(parallel);
+    fd = make_file(content);
+    const auto metrics = parallel_reader.run(fd, 3, chunk_size);
+    close(fd);
+
+    REQUIRE(parallel->events == sequential->events);
+    REQUIRE_THAT(metrics.nlines, Equals(expected.nlines));
+    REQUIRE_THAT(metrics.nstatements, Equals(expected.nstatements));
+    REQUIRE_THAT(metrics.nblocks, Equals(expected.nblocks));
+}
+
+} // unnamed namespace
+
+TEST_CASE("Reader - parallel parsing", "[reader][parallel_reader]") {
+    const auto block_size = GENERATE(1u, 3u, 7u);
+    const auto chunk_size = GENERATE(5u, 16u, 100u);
+
+    SECTION("fixed blocks") {
+        string content;
+        for (auto i = 0u; i < 100; ++i)
+            content += "cmd" + to_string(i) + "\n";
+        compare(content, block_size, chunk_size);
+    }
+
+    SECTION("nested explicit blocks across chunks") {
+        string content;
+        for (auto i = 0u; i < 200; ++i) {
+            switch (i % 23) {
+            case 3: case 5: case 17: content += "{\n"; break;
+            case 9: case 11: case 19: content += "}\n"; break;
+            default: content += "cmd" + to_string(i) + "\n"; break;
+            }
+        }
+        // the last line isn't terminated
+        compare(content + "cmd", block_size, chunk_size);
+    }
+
+    SECTION("empty explicit blocks") {
+        string content;
+        for (auto i = 0u; i < 50; ++i)
+            content += i % 4 == 0 ? "cmd\n{\n{\n}\n}\n" : "{\n}\ncmd" + to_string(i) + "\n";
+        compare(content, block_size, chunk_size);
+    }
+
+    SECTION("unexpected end of file") {
+        string content;
+        for (auto i = 0u; i < 60; ++i)
+            content += "cmd" + to_string(i) + "\n";
+        compare(content + "{\ncmd\n{\n" + content + "}\n", block_size, chunk_size);
+    }
+
+    SECTION("unexpected end of block") {
+        string content;
+        for (auto i = 0u; i < 60; ++i)
+            content += "cmd" + to_string(i) + "\n";
+        compare(content + "}\n" + content, block_size, chunk_size);
+    }
+}
\ No newline at end of file
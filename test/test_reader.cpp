@@ -1,11 +1,16 @@
 #include <catch2/catch.hpp>
 
+#include <chrono>
 #include <iostream>
 #include <sstream>
 #include <memory>
+#include <string>
+#include <thread>
 #include <vector>
 
-#include <statement.h>
+#include <unistd.h>
+
+#include <block.h>
 #include <reader.h>
 #include <reader_subscriber.h>
 
@@ -18,19 +23,19 @@ using namespace Catch::Matchers;
 
 struct ReaderMonitor : ReaderSubscriber {
 
-    std::vector<StatementContainer> blocks;
-    StatementContainer broken_block;
+    std::vector<BlockPtr> blocks;
+    BlockPtr broken_block;
 
     void clear() {
         blocks.clear();
-        broken_block.clear();
+        broken_block.reset();
     }
 
-    void on_block(const StatementContainer& stms) override {
+    void on_block(const BlockPtr& stms) override {
         blocks.push_back(stms);
     }
 
-    void on_unexpected_eof(const StatementContainer& stms) override {
+    void on_unexpected_eof(const BlockPtr& stms) override {
         broken_block = stms;
     }
 };
@@ -57,31 +62,19 @@ TEST_CASE("Reader", "[reader]") {
         REQUIRE_THAT(metrics.nblocks, Equals(2));
 
         REQUIRE_THAT(monitor->blocks.size(), Equals(2));
-        REQUIRE(monitor->broken_block.empty());
+        REQUIRE_FALSE(monitor->broken_block);
         // check first block
-        auto& block1 = monitor->blocks.front();
+        auto& block1 = *monitor->blocks.front();
         REQUIRE_THAT(block1.size(), Equals(3));
-        auto statement = dynamic_pointer_cast<SomeStatement>(block1[0]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd1"));
-        statement = dynamic_pointer_cast<SomeStatement>(block1[1]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd2"));
-        statement = dynamic_pointer_cast<SomeStatement>(block1[2]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd3"));
+        REQUIRE_THAT(block1[0], Equals("cmd1"));
+        REQUIRE_THAT(block1[1], Equals("cmd2"));
+        REQUIRE_THAT(block1[2], Equals("cmd3"));
         // check second block
-        auto& block2 = monitor->blocks.back();
+        auto& block2 = *monitor->blocks.back();
         REQUIRE_THAT(block2.size(), Equals(3));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[0]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd4"));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[1]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd5"));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[2]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd6"));
+        REQUIRE_THAT(block2[0], Equals("cmd4"));
+        REQUIRE_THAT(block2[1], Equals("cmd5"));
+        REQUIRE_THAT(block2[2], Equals("cmd6"));
     }
 
     SECTION("Fixed blocks - EOF before block has been ended") {
@@ -99,28 +92,18 @@ TEST_CASE("Reader", "[reader]") {
         REQUIRE_THAT(metrics.nblocks, Equals(2));
 
         REQUIRE_THAT(monitor->blocks.size(), Equals(2));
-        REQUIRE(monitor->broken_block.empty());
+        REQUIRE_FALSE(monitor->broken_block);
         // check first block
-        auto& block1 = monitor->blocks.front();
+        auto& block1 = *monitor->blocks.front();
         REQUIRE_THAT(block1.size(), Equals(3));
-        auto statement = dynamic_pointer_cast<SomeStatement>(block1[0]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd1"));
-        statement = dynamic_pointer_cast<SomeStatement>(block1[1]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd2"));
-        statement = dynamic_pointer_cast<SomeStatement>(block1[2]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd3"));
+        REQUIRE_THAT(block1[0], Equals("cmd1"));
+        REQUIRE_THAT(block1[1], Equals("cmd2"));
+        REQUIRE_THAT(block1[2], Equals("cmd3"));
         // check second block
-        auto& block2 = monitor->blocks.back();
+        auto& block2 = *monitor->blocks.back();
         REQUIRE_THAT(block2.size(), Equals(2));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[0]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd4"));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[1]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd5"));
+        REQUIRE_THAT(block2[0], Equals("cmd4"));
+        REQUIRE_THAT(block2[1], Equals("cmd5"));
     }
 
     SECTION("Explicit blocks") {
@@ -142,34 +125,20 @@ TEST_CASE("Reader", "[reader]") {
         REQUIRE_THAT(metrics.nblocks, Equals(2));
 
         REQUIRE_THAT(monitor->blocks.size(), Equals(2));
-        REQUIRE(monitor->broken_block.empty());
+        REQUIRE_FALSE(monitor->broken_block);
         // check first block
-        auto& block1 = monitor->blocks.front();
+        auto& block1 = *monitor->blocks.front();
         REQUIRE_THAT(block1.size(), Equals(3));
-        auto statement = dynamic_pointer_cast<SomeStatement>(block1[0]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd1"));
-        statement = dynamic_pointer_cast<SomeStatement>(block1[1]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd2"));
-        statement = dynamic_pointer_cast<SomeStatement>(block1[2]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd3"));
+        REQUIRE_THAT(block1[0], Equals("cmd1"));
+        REQUIRE_THAT(block1[1], Equals("cmd2"));
+        REQUIRE_THAT(block1[2], Equals("cmd3"));
         // check second block
-        auto& block2 = monitor->blocks.back();
+        auto& block2 = *monitor->blocks.back();
         REQUIRE_THAT(block2.size(), Equals(4));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[0]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd4"));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[1]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd5"));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[2]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd6"));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[3]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd7"));
+        REQUIRE_THAT(block2[0], Equals("cmd4"));
+        REQUIRE_THAT(block2[1], Equals("cmd5"));
+        REQUIRE_THAT(block2[2], Equals("cmd6"));
+        REQUIRE_THAT(block2[3], Equals("cmd7"));
     }
 
     SECTION("Explicit blocks - fixed block after explicit") {
@@ -194,46 +163,26 @@ TEST_CASE("Reader", "[reader]") {
         REQUIRE_THAT(metrics.nblocks, Equals(3));
 
         REQUIRE_THAT(monitor->blocks.size(), Equals(3));
-        REQUIRE(monitor->broken_block.empty());
+        REQUIRE_FALSE(monitor->broken_block);
         // check first block
-        auto& block1 = monitor->blocks.front();
+        auto& block1 = *monitor->blocks.front();
         REQUIRE_THAT(block1.size(), Equals(3));
-        auto statement = dynamic_pointer_cast<SomeStatement>(block1[0]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd1"));
-        statement = dynamic_pointer_cast<SomeStatement>(block1[1]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd2"));
-        statement = dynamic_pointer_cast<SomeStatement>(block1[2]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd3"));
+        REQUIRE_THAT(block1[0], Equals("cmd1"));
+        REQUIRE_THAT(block1[1], Equals("cmd2"));
+        REQUIRE_THAT(block1[2], Equals("cmd3"));
         // check second block
-        auto& block2 = monitor->blocks[1];
+        auto& block2 = *monitor->blocks[1];
         REQUIRE_THAT(block2.size(), Equals(4));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[0]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd4"));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[1]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd5"));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[2]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd6"));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[3]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd7"));
+        REQUIRE_THAT(block2[0], Equals("cmd4"));
+        REQUIRE_THAT(block2[1], Equals("cmd5"));
+        REQUIRE_THAT(block2[2], Equals("cmd6"));
+        REQUIRE_THAT(block2[3], Equals("cmd7"));
         // check third block
-        auto& block3 = monitor->blocks.back();
+        auto& block3 = *monitor->blocks.back();
         REQUIRE_THAT(block3.size(), Equals(3));
-        statement = dynamic_pointer_cast<SomeStatement>(block3[0]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd8"));
-        statement = dynamic_pointer_cast<SomeStatement>(block3[1]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd9"));
-        statement = dynamic_pointer_cast<SomeStatement>(block3[2]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd10"));
+        REQUIRE_THAT(block3[0], Equals("cmd8"));
+        REQUIRE_THAT(block3[1], Equals("cmd9"));
+        REQUIRE_THAT(block3[2], Equals("cmd10"));
     }
 
     SECTION("Explicit blocks - explicit block before block has been ended") {
@@ -254,31 +203,19 @@ TEST_CASE("Reader", "[reader]") {
         REQUIRE_THAT(metrics.nblocks, Equals(2));
 
         REQUIRE_THAT(monitor->blocks.size(), Equals(2));
-        REQUIRE(monitor->broken_block.empty());
+        REQUIRE_FALSE(monitor->broken_block);
         // check first block
-        auto& block1 = monitor->blocks.front();
+        auto& block1 = *monitor->blocks.front();
         REQUIRE_THAT(block1.size(), Equals(2));
-        auto statement = dynamic_pointer_cast<SomeStatement>(block1[0]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd1"));
-        statement = dynamic_pointer_cast<SomeStatement>(block1[1]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd2"));
+        REQUIRE_THAT(block1[0], Equals("cmd1"));
+        REQUIRE_THAT(block1[1], Equals("cmd2"));
         // check second block
-        auto& block2 = monitor->blocks.back();
+        auto& block2 = *monitor->blocks.back();
         REQUIRE_THAT(block2.size(), Equals(4));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[0]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd4"));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[1]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd5"));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[2]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd6"));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[3]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd7"));
+        REQUIRE_THAT(block2[0], Equals("cmd4"));
+        REQUIRE_THAT(block2[1], Equals("cmd5"));
+        REQUIRE_THAT(block2[2], Equals("cmd6"));
+        REQUIRE_THAT(block2[3], Equals("cmd7"));
     }
 
     SECTION("Explicit blocks - nested blocks") {
@@ -303,37 +240,21 @@ TEST_CASE("Reader", "[reader]") {
         REQUIRE_THAT(metrics.nblocks, Equals(2));
 
         REQUIRE_THAT(monitor->blocks.size(), Equals(2));
-        REQUIRE(monitor->broken_block.empty());
+        REQUIRE_FALSE(monitor->broken_block);
         // check first block
-        auto& block1 = monitor->blocks.front();
+        auto& block1 = *monitor->blocks.front();
         REQUIRE_THAT(block1.size(), Equals(2));
-        auto statement = dynamic_pointer_cast<SomeStatement>(block1[0]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd1"));
-        statement = dynamic_pointer_cast<SomeStatement>(block1[1]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd2"));
+        REQUIRE_THAT(block1[0], Equals("cmd1"));
+        REQUIRE_THAT(block1[1], Equals("cmd2"));
         // check second block
-        auto& block2 = monitor->blocks.back();
+        auto& block2 = *monitor->blocks.back();
         REQUIRE_THAT(block2.size(), Equals(6));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[0]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd4"));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[1]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd5"));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[2]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd6"));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[3]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd7"));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[4]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd8"));
-        statement = dynamic_pointer_cast<SomeStatement>(block2[5]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd9"));
+        REQUIRE_THAT(block2[0], Equals("cmd4"));
+        REQUIRE_THAT(block2[1], Equals("cmd5"));
+        REQUIRE_THAT(block2[2], Equals("cmd6"));
+        REQUIRE_THAT(block2[3], Equals("cmd7"));
+        REQUIRE_THAT(block2[4], Equals("cmd8"));
+        REQUIRE_THAT(block2[5], Equals("cmd9"));
     }
 
     SECTION("Explicit blocks - EOF before explicit block has been ended") {
@@ -353,32 +274,157 @@ TEST_CASE("Reader", "[reader]") {
         REQUIRE_THAT(metrics.nblocks, Equals(1));
 
         REQUIRE_FALSE(monitor->blocks.empty());
-        REQUIRE_FALSE(monitor->broken_block.empty());
+        REQUIRE(monitor->broken_block);
 
         REQUIRE_THAT(monitor->blocks.size(), Equals(1));
         // check first block
-        auto& block1 = monitor->blocks.front();
+        auto& block1 = *monitor->blocks.front();
         REQUIRE_THAT(block1.size(), Equals(2));
-        auto statement = dynamic_pointer_cast<SomeStatement>(block1[0]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd1"));
-        statement = dynamic_pointer_cast<SomeStatement>(block1[1]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd2"));
+        REQUIRE_THAT(block1[0], Equals("cmd1"));
+        REQUIRE_THAT(block1[1], Equals("cmd2"));
 
         // check broken block
-        REQUIRE_THAT(monitor->broken_block.size(), Equals(4));
-        statement = dynamic_pointer_cast<SomeStatement>(monitor->broken_block[0]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd4"));
-        statement = dynamic_pointer_cast<SomeStatement>(monitor->broken_block[1]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd5"));
-        statement = dynamic_pointer_cast<SomeStatement>(monitor->broken_block[2]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd6"));
-        statement = dynamic_pointer_cast<SomeStatement>(monitor->broken_block[3]);
-        REQUIRE(statement);
-        REQUIRE_THAT(statement->value(), Equals("cmd7"));
+        REQUIRE_THAT(monitor->broken_block->size(), Equals(4));
+        REQUIRE_THAT((*monitor->broken_block)[0], Equals("cmd4"));
+        REQUIRE_THAT((*monitor->broken_block)[1], Equals("cmd5"));
+        REQUIRE_THAT((*monitor->broken_block)[2], Equals("cmd6"));
+        REQUIRE_THAT((*monitor->broken_block)[3], Equals("cmd7"));
+    }
+}
+
+TEST_CASE("Reader - block is shared by subscribers", "[reader]") {
+
+    Reader reader(2);
+    auto monitor1 = make_shared<ReaderMonitor>();
+    auto monitor2 = make_shared<ReaderMonitor>();
+    reader.subscribe(monitor1);
+    reader.subscribe(monitor2);
+
+    istringstream is;
+    is.str(
+        "cmd1\n"
+        "cmd2\n"
+        "cmd3\n"s);
+
+    reader.run(is);
+    REQUIRE_THAT(monitor1->blocks.size(), Equals(2));
+    REQUIRE_THAT(monitor2->blocks.size(), Equals(2));
+    REQUIRE(monitor1->blocks[0] == monitor2->blocks[0]);
+    REQUIRE(monitor1->blocks[1] == monitor2->blocks[1]);
+    REQUIRE_THAT(monitor1->blocks[0].use_count(), Equals(2));
+
+    weak_ptr<const Block> weak_block = monitor1->blocks[0];
+    monitor1->clear();
+    monitor2->clear();
+    REQUIRE(weak_block.expired());
+}
+
+TEST_CASE("Reader - max age of dynamic block", "[reader]") {
+
+    // the first two statements are followed by a pause longer than max age
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    thread writer { [fd = fds[1]] {
+        const auto write_all = [fd] (const string& s) {
+            for (size_t n = 0; n < s.size();)
+                n += static_cast<size_t>(write(fd, s.data() + n, s.size() - n));
+        };
+        write_all("cmd1\ncmd2\n"s);
+        this_thread::sleep_for(300ms);
+        write_all("cmd3\ncmd4\ncmd5\ncmd6\n"s);
+        close(fd);
+    } };
+
+    Reader reader(3, 50ms);
+    auto monitor = make_shared<ReaderMonitor>();
+    reader.subscribe(monitor);
+    auto metrics = reader.run(fds[0]);
+    writer.join();
+    close(fds[0]);
+
+    REQUIRE_THAT(metrics.nblocks, Equals(3));
+    REQUIRE_THAT(metrics.nexpired, Equals(1));
+    REQUIRE_THAT(monitor->blocks.size(), Equals(3));
+    REQUIRE_THAT(monitor->blocks[0]->size(), Equals(2));
+    REQUIRE_THAT((*monitor->blocks[0])[1], Equals("cmd2"));
+    REQUIRE_THAT(monitor->blocks[1]->size(), Equals(3));
+    REQUIRE_THAT((*monitor->blocks[1])[0], Equals("cmd3"));
+    REQUIRE_THAT(monitor->blocks[2]->size(), Equals(1));
+    REQUIRE_THAT((*monitor->blocks[2])[0], Equals("cmd6"));
+
+    // the expired block has waited at least max age
+    REQUIRE(metrics.block_age.max >= 50ms);
+    REQUIRE(metrics.block_age.p50 <= metrics.block_age.p99);
+    REQUIRE(metrics.block_age.p99 <= metrics.block_age.max);
+}
+
+TEST_CASE("Reader - fed input", "[reader]") {
+
+    const auto input =
+        "cmd1\n"
+        "cmd2\n"
+        "{\n"
+        "cmd3\n"
+        "{\n"
+        "long command 4\n"
+        "}\n"
+        "cmd5\n"
+        "}\n"
+        "cmd6\n"
+        "cmd7\n"
+        "cmd8\n"
+        "cmd9"s;
+
+    const auto blocks_of = [] (const ReaderMonitor& monitor) {
+        vector<vector<string>> blocks;
+        for (auto& block : monitor.blocks)
+            blocks.emplace_back(block->begin(), block->end());
+        return blocks;
+    };
+
+    Reader reader(2);
+    auto monitor = make_shared<ReaderMonitor>();
+    reader.subscribe(monitor);
+
+    istringstream is { input };
+    const auto expected_metrics = reader.run(is);
+    const auto expected = blocks_of(*monitor);
+    REQUIRE_THAT(expected.size(), Equals(4));
+
+    const auto portion_size = GENERATE(1, 2, 3, 5, 7, 100);
+    monitor->clear();
+    for (size_t i = 0; i < input.size(); i += portion_size) {
+        // fed bytes aren't used after feed returns
+        string portion = input.substr(i, portion_size);
+        reader.feed(portion);
+        fill(portion.begin(), portion.end(), '#');
+    }
+    const auto metrics = reader.finish();
+
+    REQUIRE(blocks_of(*monitor) == expected);
+    REQUIRE_FALSE(monitor->broken_block);
+    REQUIRE_THAT(metrics.nlines, Equals(expected_metrics.nlines));
+    REQUIRE_THAT(metrics.nstatements, Equals(expected_metrics.nstatements));
+    REQUIRE_THAT(metrics.nblocks, Equals(expected_metrics.nblocks));
+
+    SECTION("Blocks are notified as soon as they are complete") {
+        monitor->clear();
+        reader.feed("cmd1\ncm"s);
+        REQUIRE(monitor->blocks.empty());
+        reader.feed("d2\ncmd3"s);
+        REQUIRE_THAT(monitor->blocks.size(), Equals(1));
+        reader.feed("\n{\ncmd4\n"s);
+        REQUIRE_THAT(monitor->blocks.size(), Equals(2));
+        REQUIRE_THAT((*monitor->blocks[1])[0], Equals("cmd3"));
+        reader.finish();
+        REQUIRE_THAT(monitor->blocks.size(), Equals(2));
+        REQUIRE(monitor->broken_block);
+        REQUIRE_THAT((*monitor->broken_block)[0], Equals("cmd4"));
+    }
+
+    SECTION("Empty input") {
+        monitor->clear();
+        REQUIRE_THAT(reader.finish().nlines, Equals(0));
+        REQUIRE(monitor->blocks.empty());
     }
 }
\ No newline at end of file
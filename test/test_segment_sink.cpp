@@ -0,0 +1,113 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <block.h>
+#include <segment_sink.h>
+
+#include "utils.h"
+
+using namespace std;
+using namespace griha;
+using namespace Catch;
+using namespace Catch::Matchers;
+
+namespace {
+
+// sorted names of files with given suffix
+vector<string> list_files(const string& dir, const string& suffix) {
+    vector<string> names;
+    auto d = opendir(dir.c_str());
+    while (auto entry = readdir(d)) {
+        string name = entry->d_name;
+        if (name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+            names.push_back(dir + "/" + name);
+    }
+    closedir(d);
+    sort(names.begin(), names.end());
+    return names;
+}
+
+} // unnamed namespace
+
+TEST_CASE("SegmentWriter", "[segment_sink]") {
+    const auto dir = make_temp_dir("segments");
+
+    SegmentOptions options;
+    options.dir = dir;
+
+    SECTION("single segment") {
+        {
+            SegmentWriter writer { options, 0 };
+            writer.write(*make_block({ "cmd1", "cmd2" }, 1));
+            writer.write(*make_block({ "cmd3" }, 2));
+            REQUIRE_THAT(writer.nsegments(), Equals(1));
+        }
+
+        auto segments = list_files(dir, ".seg");
+        auto indexes = list_files(dir, ".idx");
+        REQUIRE_THAT(segments.size(), Equals(1));
+        REQUIRE_THAT(indexes.size(), Equals(1));
+        REQUIRE_THAT(read_file(segments[0]), Equals("cmd1\ncmd2\ncmd3\n"s));
+
+        auto index = read_file(indexes[0]);
+        REQUIRE_THAT(index.size(), Equals(2 * sizeof(SegmentWriter::IndexRecord)));
+        auto records = reinterpret_cast<const SegmentWriter::IndexRecord*>(index.data());
+        REQUIRE_THAT(records[0].block_id, Equals(1));
+        REQUIRE_THAT(records[0].offset, Equals(0));
+        REQUIRE_THAT(records[1].block_id, Equals(2));
+        REQUIRE_THAT(records[1].offset, Equals(10));
+    }
+
+    SECTION("rotation by size") {
+        options.max_size = 8;
+        {
+            SegmentWriter writer { options, 0 };
+            writer.write(*make_block({ "cmd1", "cmd2" }, 1)); // 10 bytes exceed limit
+            writer.write(*make_block({ "cmd3" }, 2));
+            writer.write(*make_block({ "cmd4" }, 3));
+            REQUIRE_THAT(writer.nsegments(), Equals(2));
+        }
+
+        auto segments = list_files(dir, ".seg");
+        REQUIRE_THAT(segments.size(), Equals(2));
+        string all;
+        for (auto& name : segments)
+            all += read_file(name);
+        REQUIRE_THAT(all, Equals("cmd1\ncmd2\ncmd3\ncmd4\n"s));
+
+        // offsets are restarted in every segment
+        auto index = read_file(list_files(dir, ".idx")[1]);
+        REQUIRE_THAT(index.size(), Equals(2 * sizeof(SegmentWriter::IndexRecord)));
+        auto records = reinterpret_cast<const SegmentWriter::IndexRecord*>(index.data());
+        REQUIRE_THAT(records[0].block_id, Equals(2));
+        REQUIRE_THAT(records[0].offset, Equals(0));
+        REQUIRE_THAT(records[1].block_id, Equals(3));
+        REQUIRE_THAT(records[1].offset, Equals(5));
+    }
+
+    for (auto& name : list_files(dir, ".seg"))
+        remove(name.c_str());
+    for (auto& name : list_files(dir, ".idx"))
+        remove(name.c_str());
+    rmdir(dir.c_str());
+}
+
+TEST_CASE("SegmentSink - directory is checked", "[segment_sink]") {
+    SegmentOptions options;
+    options.dir = "/nonexistent/segments";
+    REQUIRE_THROWS_AS(SegmentSink { options }, system_error);
+
+    options.dir = "/dev/null";
+    REQUIRE_THROWS_AS(SegmentSink { options }, system_error);
+
+    options.dir = "/tmp";
+    REQUIRE_NOTHROW(SegmentSink { options });
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <block.h>
+#include <reader_subscriber.h>
+#include <server.h>
+#include <socket_address.h>
+
+#include "utils.h"
+
+using namespace std;
+using namespace griha;
+using namespace Catch;
+using namespace Catch::Matchers;
+
+namespace {
+
+using Blocks = vector<vector<string>>;
+
+// blocks are notified by server thread
+struct ServerMonitor : ReaderSubscriber {
+    mutex guard;
+    Blocks blocks;
+    Blocks broken_blocks;
+
+    void on_block(const BlockPtr& block) override {
+        lock_guard<mutex> lock { guard };
+        blocks.emplace_back(block->begin(), block->end());
+    }
+
+    void on_unexpected_eof(const BlockPtr& block) override {
+        lock_guard<mutex> lock { guard };
+        broken_blocks.emplace_back(block->begin(), block->end());
+    }
+
+    size_t nblocks() {
+        lock_guard<mutex> lock { guard };
+        return blocks.size();
+    }
+};
+
+string socket_path() {
+    return "unix:/tmp/bulkmt_test_" + to_string(getpid()) + ".sock";
+}
+
+void send(const string& address, const string& content) {
+    auto fd = connect_socket(parse_socket_address(address));
+    REQUIRE(write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+    close(fd);
+}
+
+} // unnamed namespace
+
+TEST_CASE("Server", "[server]") {
+
+    const auto address = socket_path();
+    auto monitor = make_shared<ServerMonitor>();
+
+    SECTION("Shared dynamic block and separate explicit blocks") {
+        Server server { ServerOptions { address }, 3 };
+        server.subscribe(monitor);
+        thread loop { [&server] { server.run(); } };
+
+        send(address, "a1\n{\nx1\n{\nx2\n}\n}\na2\n");
+        send(address, "b1\n{\ny1\n");           // explicit block isn't completed
+        send(address, "c1\n}\nc2\n");           // syntax error closes the connection
+        send(address, "d1\n{\nz1\n}\nd2");      // the last line isn't terminated
+
+        server.stop();
+        loop.join();
+
+        // shared statements are grouped by block size in order of arrival
+        Blocks explicit_blocks, shared_blocks;
+        for (auto& block : monitor->blocks)
+            (block[0][0] == 'x' || block[0][0] == 'z' ? explicit_blocks : shared_blocks).push_back(block);
+        REQUIRE(explicit_blocks == (Blocks { { "x1", "x2" }, { "z1" } }));
+        REQUIRE_THAT(shared_blocks.size(), Equals(2));
+        REQUIRE_THAT(shared_blocks[0].size(), Equals(3));
+        REQUIRE_THAT(shared_blocks[1].size(), Equals(3));
+        vector<string> shared;
+        for (auto& block : shared_blocks)
+            shared.insert(shared.end(), block.begin(), block.end());
+        sort(shared.begin(), shared.end());
+        REQUIRE(shared == (vector<string> { "a1", "a2", "b1", "c1", "d1", "d2" }));
+        REQUIRE(monitor->broken_blocks == (Blocks { { "y1" } }));
+
+        auto& metrics = server.server_metrics();
+        REQUIRE_THAT(metrics.naccepted, Equals(4));
+        REQUIRE_THAT(metrics.nrejected, Equals(1));
+    }
+
+    SECTION("Shared block is flushed by max age") {
+        Server server { ServerOptions { address }, 10, 50ms };
+        server.subscribe(monitor);
+        Reader::Metrics metrics;
+        thread loop { [&server, &metrics] { metrics = server.run(); } };
+
+        auto fd = connect_socket(parse_socket_address(address));
+        REQUIRE(write(fd, "a\nb\n", 4) == 4);
+        const auto deadline = chrono::steady_clock::now() + 5s;
+        while (monitor->nblocks() == 0 && chrono::steady_clock::now() < deadline)
+            this_thread::sleep_for(10ms);
+        REQUIRE_THAT(monitor->nblocks(), Equals(1));
+        close(fd);
+
+        server.stop();
+        loop.join();
+        REQUIRE(monitor->blocks == (Blocks { { "a", "b" } }));
+        REQUIRE_THAT(metrics.nexpired, Equals(1));
+        REQUIRE(metrics.block_age.max >= 50ms);
+    }
+
+    SECTION("Too long line closes the connection") {
+        ServerOptions options { address };
+        options.max_line = 16;
+        Server server { options, 10 };
+        server.subscribe(monitor);
+        thread loop { [&server] { server.run(); } };
+
+        send(address, "a\n" + string(10, 'x') + "\nb\n");
+        auto fd = connect_socket(parse_socket_address(address));
+        const string chunk(10, 'y');
+        // server closes the connection as soon as line exceeds the limit
+        while (::send(fd, chunk.data(), chunk.size(), MSG_NOSIGNAL) > 0)
+            this_thread::sleep_for(1ms);
+        close(fd);
+
+        server.stop();
+        loop.join();
+        REQUIRE(monitor->blocks == (Blocks { { "a", string(10, 'x'), "b" } }));
+        REQUIRE_THAT(server.server_metrics().nrejected, Equals(1));
+    }
+
+    SECTION("Bad address") {
+        REQUIRE_THROWS(Server { ServerOptions { "no port" }, 3 });
+        REQUIRE_THROWS(Server { ServerOptions { "unix:/nonexistent/dir/socket" }, 3 });
+    }
+}
\ No newline at end of file
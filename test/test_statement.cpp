@@ -1,7 +1,10 @@
 #include <catch2/catch.hpp>
 
 #include <memory>
+#include <string>
+#include <vector>
 
+#include <block.h>
 #include <statement.h>
 #include <statement_factory.h>
 
@@ -14,9 +17,21 @@ using namespace Catch::Matchers;
 
 struct TestExecuter : Executer {
     string last_statement;
+    size_t nstatements = 0;
 
+    using Executer::execute;
     void execute(const SomeStatement& stm) override {
-        last_statement = "SomeStatement { "s + stm.value() + " }"s;
+        last_statement = "SomeStatement { "s + string { stm.value() } + " }"s;
+        ++nstatements;
+    }
+};
+
+struct BatchExecuter : TestExecuter {
+    vector<string> batches;
+
+    using TestExecuter::execute;
+    void execute(const StatementBatch<SomeStatement>& batch) override {
+        batches.emplace_back(batch.bytes());
     }
 };
 
@@ -40,3 +55,49 @@ TEST_CASE("Statement execution", "[statement]") {
         executer.last_statement,
         Equals("SomeStatement { cmd }"));
 }
+
+TEST_CASE("Statement batches", "[statement][block]") {
+    auto block = make_block({ "cmd1", "", "cmd3" });
+
+    SECTION("static visitor gets whole block as one run") {
+        vector<string> values;
+        size_t nbatches = 0;
+        visit_batches(*block, [&] (const StatementBatch<SomeStatement>& batch) {
+            ++nbatches;
+            REQUIRE(batch.size() == 3);
+            REQUIRE_THAT(batch.bytes(), Equals("cmd1\n\ncmd3\n"));
+            REQUIRE_THAT(batch[2], Equals("cmd3"));
+            for (auto value : batch)
+                values.emplace_back(value);
+        });
+        REQUIRE(nbatches == 1);
+        REQUIRE(values == vector<string> { "cmd1", "", "cmd3" });
+    }
+
+    SECTION("empty block has no runs") {
+        size_t nbatches = 0;
+        visit_batches(*make_block({}), [&nbatches] (const auto&) { ++nbatches; });
+        REQUIRE(nbatches == 0);
+    }
+
+    SECTION("part of block") {
+        StatementBatch<SomeStatement> batch { *block, 1, 3 };
+        REQUIRE(batch.size() == 2);
+        REQUIRE_THAT(batch.bytes(), Equals("\ncmd3\n"));
+        REQUIRE(StatementBatch<SomeStatement>(*block, 1, 1).bytes().empty());
+    }
+
+    SECTION("statement visitor gets statements one by one") {
+        TestExecuter executer;
+        executer.execute(*block);
+        REQUIRE(executer.nstatements == 3);
+        REQUIRE_THAT(executer.last_statement, Equals("SomeStatement { cmd3 }"));
+    }
+
+    SECTION("batch visitor gets runs") {
+        BatchExecuter executer;
+        executer.execute(*block);
+        REQUIRE(executer.nstatements == 0);
+        REQUIRE(executer.batches == vector<string> { "cmd1\n\ncmd3\n" });
+    }
+}
@@ -0,0 +1,112 @@
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include <trace.h>
+
+#include "utils.h"
+
+using namespace std;
+using namespace griha;
+using namespace Catch;
+using namespace Catch::Matchers;
+
+namespace {
+
+string dumped() {
+    ostringstream os;
+    trace::dump(os);
+    return os.str();
+}
+
+string temp_path() {
+    return "/tmp/bulkmt_trace_" + to_string(getpid()) + ".json";
+}
+
+} // unnamed namespace
+
+TEST_CASE("nothing is recorded before start", "[trace]") {
+    trace::reset();
+    {
+        trace::Span span { "test", "ignored" };
+        trace::instant("test", "ignored too");
+    }
+    REQUIRE_FALSE(trace::enabled());
+    REQUIRE_THAT(dumped(), !Contains("ignored"));
+}
+
+TEST_CASE("spans and instants are dumped as Chrome trace", "[trace]") {
+    const auto path = temp_path();
+    trace::reset();
+    trace::start(path, 0);
+    REQUIRE(trace::enabled());
+
+    trace::name_thread("main");
+    {
+        trace::Span outer { "test", "outer" };
+        trace::Span inner { "test", "inner" };
+    }
+    trace::instant("test", "mark");
+    thread { [] {
+        trace::name_thread("helper");
+        trace::Span span { "test", "helper span" };
+    } }.join();
+
+    const auto json = dumped();
+    REQUIRE_THAT(json, StartsWith("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    REQUIRE_THAT(json, Contains("\"args\":{\"name\":\"main\"}"));
+    REQUIRE_THAT(json, Contains("\"args\":{\"name\":\"helper\"}"));
+    REQUIRE_THAT(json, Contains("{\"ph\":\"X\",\"cat\":\"test\",\"name\":\"outer\""));
+    REQUIRE_THAT(json, Contains("{\"ph\":\"X\",\"cat\":\"test\",\"name\":\"inner\""));
+    REQUIRE_THAT(json, Contains("{\"ph\":\"X\",\"cat\":\"test\",\"name\":\"helper span\""));
+    REQUIRE_THAT(json, Contains("{\"ph\":\"i\",\"cat\":\"test\",\"name\":\"mark\""));
+    REQUIRE_THAT(json, EndsWith("\"otherData\":{\"dropped\":0}}\n"));
+    // inner span ends first
+    REQUIRE(json.find("\"inner\"") < json.find("\"outer\""));
+
+    trace::stop();
+    REQUIRE_FALSE(trace::enabled());
+    REQUIRE(read_file(path) == json);
+
+    trace::reset();
+    REQUIRE_THAT(dumped(), !Contains("outer"));
+    remove(path.c_str());
+}
+
+TEST_CASE("events above thread capacity are dropped", "[trace]") {
+    const auto path = temp_path();
+    trace::reset();
+    trace::start(path, 0);
+    for (size_t i = 0; i < trace::c_thread_capacity + 3; ++i)
+        trace::instant("test", "flood");
+    trace::stop();
+
+    REQUIRE_THAT(read_file(path), EndsWith("\"otherData\":{\"dropped\":3}}\n"));
+    trace::reset();
+    remove(path.c_str());
+}
+
+TEST_CASE("trace is dumped on signal", "[trace]") {
+    const auto path = temp_path();
+    remove(path.c_str());
+    trace::reset();
+    trace::start(path, SIGUSR1);
+    trace::instant("test", "before signal");
+    raise(SIGUSR1);
+
+    // dumper thread writes the file asynchronously
+    for (auto i = 0; i < 500 && read_file(path).empty(); ++i)
+        this_thread::sleep_for(chrono::milliseconds { 10 });
+    REQUIRE_THAT(read_file(path), Contains("\"before signal\""));
+
+    trace::stop();
+    trace::reset();
+    remove(path.c_str());
+}
\ No newline at end of file
@@ -2,7 +2,16 @@
 
 #include <catch2/catch.hpp>
 
+#include <cstdint>
+#include <fstream>
+#include <iterator>
 #include <sstream>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+
+#include <block.h>
 
 template<typename T>
 class equals : public Catch::MatcherBase<T> {
@@ -31,6 +40,26 @@ inline auto Equals(const char* str) {
     return equals<std::string_view>(str);
 }
 
+// block of values that don't belong to any input chunk
+inline griha::BlockPtr make_block(const std::vector<std::string>& values, uint64_t id = 0) {
+    griha::BlockBuilder builder;
+    for (auto& value : values)
+        builder.append(value, nullptr);
+    return builder.build(id);
+}
+
+inline std::string read_file(const std::string& name) {
+    std::ifstream input { name, std::ios::binary };
+    return { std::istreambuf_iterator<char> { input }, std::istreambuf_iterator<char> {} };
+}
+
+// new empty directory /tmp/bulkmt_<name>_XXXXXX, test removes it
+inline std::string make_temp_dir(const std::string& name) {
+    std::string dir = "/tmp/bulkmt_" + name + "_XXXXXX";
+    REQUIRE(mkdtemp(&dir[0]) != nullptr);
+    return dir;
+}
+
 namespace std {
 
 template<typename Ch, typename T1, typename T2>